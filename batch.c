@@ -0,0 +1,422 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "batch.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "args.h"
+#include "stats.h"
+#include "utils.h"
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING
+#endif
+#endif
+
+static int use_uring;
+
+static int set_io_uring(_unused char *arg)
+{
+	use_uring = 1;
+	return 0;
+}
+
+static struct arg_option options[] = {
+	{ .long_name = "io-uring", .short_name = '\0', .has_arg = 0,
+	  .type = ARG_CALLBACK, .action.callback = set_io_uring,
+	  .help = "read batches of small files using io_uring",
+	},
+};
+
+void batch_register(void)
+{
+	arg_register_batch(options, ARRAY_SIZE(options));
+}
+
+static void batch_done(struct batch_read *r, ssize_t len)
+{
+	if (len < 0) {
+		r->buf[0] = '\0';
+		r->res = len;
+		return;
+	}
+	/* Strip the last newline, as we usually read one line only */
+	if (len > 0 && r->buf[len - 1] == '\n')
+		len--;
+	r->buf[len] = '\0';
+	r->res = len;
+}
+
+/* Returns the number of syscalls made. */
+static unsigned long batch_plain(struct batch_read *reqs, unsigned int count)
+{
+	unsigned long calls = 0;
+	unsigned int i;
+	ssize_t len;
+	int fd;
+
+	for (i = 0; i < count; i++) {
+		calls++;
+		fd = openat(reqs[i].dirfd, reqs[i].path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			batch_done(&reqs[i], -errno);
+			continue;
+		}
+		calls += 2;
+		len = read(fd, reqs[i].buf, reqs[i].size - 1);
+		batch_done(&reqs[i], len < 0 ? -errno : len);
+		close(fd);
+	}
+	return calls;
+}
+
+#ifdef HAVE_IO_URING
+
+/* Files per round trip; every file needs two entries in the second phase. */
+#define BATCH_RING_FILES	64
+/* Below this, the two round trips cost more than the plain syscalls. */
+#define BATCH_URING_MIN		4
+#define BATCH_CLOSE		(1ULL << 32)
+
+struct batch_ring {
+	int fd;
+	void *sq_ptr, *cq_ptr;
+	size_t sq_len, cq_len, sqes_len;
+	unsigned int *sq_tail, *sq_mask, *sq_array;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	unsigned long calls;
+};
+
+/* Set once io_uring is found not to work, so that it's not retried for
+ * every batch. */
+static int uring_broken;
+
+/* Every thread sets up its ring on the first batch and keeps it until it
+ * exits. */
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+
+static void ring_free(struct batch_ring *ring)
+{
+	if (ring->sqes != MAP_FAILED)
+		munmap(ring->sqes, ring->sqes_len);
+	if (ring->cq_ptr != MAP_FAILED)
+		munmap(ring->cq_ptr, ring->cq_len);
+	if (ring->sq_ptr != MAP_FAILED)
+		munmap(ring->sq_ptr, ring->sq_len);
+	if (ring->fd >= 0)
+		close(ring->fd);
+	free(ring);
+}
+
+static void ring_destroy(void *ring)
+{
+	ring_free(ring);
+}
+
+static void ring_key_init(void)
+{
+	if (pthread_key_create(&ring_key, ring_destroy))
+		__atomic_store_n(&uring_broken, 1, __ATOMIC_RELAXED);
+}
+
+static void *ring_mmap(struct batch_ring *ring, size_t len, off_t offset)
+{
+	ring->calls++;
+	return mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		    ring->fd, offset);
+}
+
+static int ring_setup(struct batch_ring *ring, unsigned int entries)
+{
+	struct io_uring_params p;
+
+	memset(&p, 0, sizeof(p));
+	ring->sq_ptr = ring->cq_ptr = ring->sqes = MAP_FAILED;
+	ring->calls++;
+	ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (ring->fd < 0)
+		return errno;
+
+	ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sq_ptr = ring_mmap(ring, ring->sq_len, IORING_OFF_SQ_RING);
+	if (ring->sq_ptr == MAP_FAILED)
+		return errno;
+	ring->cq_ptr = ring_mmap(ring, ring->cq_len, IORING_OFF_CQ_RING);
+	if (ring->cq_ptr == MAP_FAILED)
+		return errno;
+	ring->sqes = ring_mmap(ring, ring->sqes_len, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+		return errno;
+
+	ring->sq_tail = (void *)((char *)ring->sq_ptr + p.sq_off.tail);
+	ring->sq_mask = (void *)((char *)ring->sq_ptr + p.sq_off.ring_mask);
+	ring->sq_array = (void *)((char *)ring->sq_ptr + p.sq_off.array);
+	ring->cq_head = (void *)((char *)ring->cq_ptr + p.cq_off.head);
+	ring->cq_tail = (void *)((char *)ring->cq_ptr + p.cq_off.tail);
+	ring->cq_mask = (void *)((char *)ring->cq_ptr + p.cq_off.ring_mask);
+	ring->cqes = (void *)((char *)ring->cq_ptr + p.cq_off.cqes);
+	return 0;
+}
+
+/* Returns the ring of the calling thread, setting it up if needed. */
+static struct batch_ring *ring_get(void)
+{
+	struct batch_ring *ring;
+
+	pthread_once(&ring_once, ring_key_init);
+	if (__atomic_load_n(&uring_broken, __ATOMIC_RELAXED))
+		return NULL;
+	ring = pthread_getspecific(ring_key);
+	if (ring)
+		return ring;
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+	if (ring_setup(ring, 2 * BATCH_RING_FILES) ||
+	    pthread_setspecific(ring_key, ring)) {
+		stats_count("batch syscalls", ring->calls + 4);
+		ring_free(ring);
+		return NULL;
+	}
+	return ring;
+}
+
+/* Drops the ring of the calling thread after an error; its state is not
+ * known anymore. */
+static void ring_put_broken(struct batch_ring *ring)
+{
+	pthread_setspecific(ring_key, NULL);
+	ring_free(ring);
+}
+
+static struct io_uring_sqe *ring_sqe(struct batch_ring *ring, unsigned int *tail)
+{
+	unsigned int idx = *tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	ring->sq_array[idx] = idx;
+	(*tail)++;
+	return sqe;
+}
+
+/* Submits n queued entries and usually waits for their completion, too.
+ * io_uring_enter returns the number of the submitted entries, though, and
+ * the wait may be cut short; the completions are counted by ring_cqe. */
+static int ring_submit(struct batch_ring *ring, unsigned int tail, unsigned int n)
+{
+	unsigned int done = 0;
+	int ret;
+
+	__atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+	while (done < n) {
+		ring->calls++;
+		ret = syscall(__NR_io_uring_enter, ring->fd, n - done, n,
+			      IORING_ENTER_GETEVENTS, NULL, 0);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (!ret)
+			return EIO;
+		done += ret;
+	}
+	return 0;
+}
+
+/* Returns the next completion, waiting for it if needed. pending is the
+ * number of the completions still expected, including this one. */
+static int ring_cqe(struct batch_ring *ring, unsigned int pending, uint64_t *data,
+		    int *res)
+{
+	struct io_uring_cqe *cqe;
+	unsigned int head;
+	int ret;
+
+	while (1) {
+		head = *ring->cq_head;
+		if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+			break;
+		ring->calls++;
+		ret = syscall(__NR_io_uring_enter, ring->fd, 0, pending,
+			      IORING_ENTER_GETEVENTS, NULL, 0);
+		if (ret < 0 && errno != EINTR)
+			return errno;
+	}
+	cqe = &ring->cqes[head & *ring->cq_mask];
+	*data = cqe->user_data;
+	*res = cqe->res;
+	__atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static void batch_close_fds(struct batch_ring *ring, int *fds, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		if (fds[i] >= 0) {
+			ring->calls++;
+			close(fds[i]);
+		}
+	}
+}
+
+/* Opens all the files in one round trip, then reads and closes them in
+ * another one. The close is hard linked to the read, so that it's done
+ * even if the read fails. Every round trip waits for all of its
+ * completions, so that none is left for the next one. */
+static int batch_uring_files(struct batch_ring *ring, struct batch_read *reqs,
+			     unsigned int count)
+{
+	int fds[BATCH_RING_FILES];
+	struct io_uring_sqe *sqe;
+	unsigned int tail, i, n;
+	uint64_t data;
+	int res, err;
+
+	tail = *ring->sq_tail;
+	for (i = 0; i < count; i++) {
+		sqe = ring_sqe(ring, &tail);
+		sqe->opcode = IORING_OP_OPENAT;
+		sqe->fd = reqs[i].dirfd;
+		sqe->addr = (uintptr_t)reqs[i].path;
+		sqe->open_flags = O_RDONLY | O_CLOEXEC;
+		sqe->user_data = i;
+		fds[i] = -EIO;
+		batch_done(&reqs[i], -EIO);
+	}
+	if ((err = ring_submit(ring, tail, count)))
+		return err;
+	for (n = 0; n < count; n++) {
+		if ((err = ring_cqe(ring, count - n, &data, &res))) {
+			batch_close_fds(ring, fds, count);
+			return err;
+		}
+		if (data < count)
+			fds[data] = res;
+	}
+	/* kernels without IORING_OP_OPENAT fail every request this way */
+	if (fds[0] == -EINVAL) {
+		batch_close_fds(ring, fds, count);
+		return EOPNOTSUPP;
+	}
+
+	n = 0;
+	for (i = 0; i < count; i++) {
+		if (fds[i] < 0) {
+			batch_done(&reqs[i], fds[i]);
+			continue;
+		}
+		sqe = ring_sqe(ring, &tail);
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = fds[i];
+		sqe->addr = (uintptr_t)reqs[i].buf;
+		sqe->len = reqs[i].size - 1;
+		sqe->flags = IOSQE_IO_HARDLINK;
+		sqe->user_data = i;
+		sqe = ring_sqe(ring, &tail);
+		sqe->opcode = IORING_OP_CLOSE;
+		sqe->fd = fds[i];
+		sqe->user_data = i | BATCH_CLOSE;
+		n += 2;
+	}
+	if (!n)
+		return 0;
+	if ((err = ring_submit(ring, tail, n))) {
+		batch_close_fds(ring, fds, count);
+		return err;
+	}
+	for (; n; n--) {
+		if ((err = ring_cqe(ring, n, &data, &res)))
+			return err;
+		i = data & ~BATCH_CLOSE;
+		if (i >= count)
+			continue;
+		if (!(data & BATCH_CLOSE)) {
+			batch_done(&reqs[i], res);
+		} else if (res < 0) {
+			ring->calls++;
+			close(fds[i]);
+		}
+	}
+	return 0;
+}
+
+static int batch_uring(struct batch_read *reqs, unsigned int count,
+		       unsigned long *calls)
+{
+	struct batch_ring *ring;
+	unsigned int n;
+	int err = 0;
+
+	ring = ring_get();
+	if (!ring) {
+		*calls = 0;
+		return EOPNOTSUPP;
+	}
+	for (; count; reqs += n, count -= n) {
+		n = count < BATCH_RING_FILES ? count : BATCH_RING_FILES;
+		if ((err = batch_uring_files(ring, reqs, n)))
+			break;
+	}
+	*calls = ring->calls;
+	ring->calls = 0;
+	if (err) {
+		*calls += 4;
+		ring_put_broken(ring);
+	}
+	return err;
+}
+
+#endif
+
+void batch_read(struct batch_read *reqs, unsigned int count)
+{
+	unsigned long calls;
+
+	if (!count)
+		return;
+	stats_count("batch files", count);
+#ifdef HAVE_IO_URING
+	if (use_uring && count >= BATCH_URING_MIN &&
+	    !__atomic_load_n(&uring_broken, __ATOMIC_RELAXED)) {
+		if (!batch_uring(reqs, count, &calls)) {
+			stats_count("batch syscalls", calls);
+			return;
+		}
+		/* start over with plain syscalls */
+		__atomic_store_n(&uring_broken, 1, __ATOMIC_RELAXED);
+		stats_count("batch syscalls", calls);
+	}
+#endif
+	calls = batch_plain(reqs, count);
+	stats_count("batch syscalls", calls);
+}
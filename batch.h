@@ -0,0 +1,40 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include <sys/types.h>
+
+/*
+ * Reads of many small files, such as /proc/<pid>/comm or sysfs
+ * attributes. With --io-uring, the whole batch is opened, read and closed
+ * by a few io_uring_enter calls; otherwise, or when io_uring is not
+ * available, by plain syscalls.
+ */
+struct batch_read {
+	int dirfd;
+	const char *path;	/* relative to dirfd */
+	char *buf;
+	size_t size;		/* at least 1 */
+	/* Result: the length read or -errno. buf is always NUL terminated
+	 * and the trailing newline is stripped. */
+	ssize_t res;
+};
+
+void batch_register(void);
+void batch_read(struct batch_read *reqs, unsigned int count);
+
+#endif
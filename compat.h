@@ -20,12 +20,34 @@
 #define UNIX_PATH_MAX	108
 #endif
 
+#define IFLA_EXT_MASK		29
 #define IFLA_LINK_NETNSID	37
+#define IFLA_PHYS_PORT_NAME	38
 #define IFLA_XDP		43
+#define IFLA_PARENT_DEV_NAME	56
+#define IFLA_PARENT_DEV_BUS_NAME	57
 
-#if IFLA_MAX < IFLA_XDP
+#if IFLA_MAX < IFLA_PARENT_DEV_BUS_NAME
 #undef IFLA_MAX
-#define IFLA_MAX IFLA_XDP
+#define IFLA_MAX IFLA_PARENT_DEV_BUS_NAME
+#endif
+
+#define IFLA_INFO_SLAVE_KIND	4
+#define IFLA_INFO_SLAVE_DATA	5
+
+#if IFLA_INFO_MAX < IFLA_INFO_SLAVE_DATA
+#undef IFLA_INFO_MAX
+#define IFLA_INFO_MAX IFLA_INFO_SLAVE_DATA
+#endif
+
+#ifndef RTEXT_FILTER_VF
+#define RTEXT_FILTER_VF		(1 << 0)
+#endif
+#ifndef RTEXT_FILTER_BRVLAN
+#define RTEXT_FILTER_BRVLAN	(1 << 1)
+#endif
+#ifndef RTEXT_FILTER_SKIP_STATS
+#define RTEXT_FILTER_SKIP_STATS	(1 << 3)
 #endif
 
 #define NETNSA_NSID		1
@@ -45,6 +67,37 @@
 #define RTM_MAX (((RTM_GETNSID + 4) & ~3) - 1)
 #endif
 
+#ifndef SOL_NETLINK
+#define SOL_NETLINK		270
+#endif
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK	12
+#endif
+
+#ifndef NS_GET_NSTYPE
+#define NS_GET_NSTYPE		_IO(0xb7, 0x3)
+#endif
+
+/* new mount API, the syscall numbers are the same on all architectures */
+#ifndef __NR_fsopen
+#define __NR_fsopen		430
+#endif
+#ifndef __NR_fsconfig
+#define __NR_fsconfig		431
+#endif
+#ifndef __NR_fsmount
+#define __NR_fsmount		432
+#endif
+#ifndef FSOPEN_CLOEXEC
+#define FSOPEN_CLOEXEC		0x00000001
+#endif
+#ifndef FSMOUNT_CLOEXEC
+#define FSMOUNT_CLOEXEC		0x00000001
+#endif
+#ifndef FSCONFIG_CMD_CREATE
+#define FSCONFIG_CMD_CREATE	6
+#endif
+
 #define OVS_VPORT_FAMILY	"ovs_vport"
 #define OVS_VPORT_CMD_GET	3
 #define OVS_VPORT_ATTR_NAME	3
@@ -93,6 +146,26 @@ enum {
 #define IFLA_BOND_MAX	(__IFLA_BOND_MAX - 1)
 #endif
 
+#define IFLA_BRPORT_STATE		1
+#define IFLA_BRPORT_LEARNING		8
+#define IFLA_BRPORT_UNICAST_FLOOD	9
+#define IFLA_BRPORT_MCAST_FLOOD		27
+#define IFLA_BRPORT_BCAST_FLOOD		30
+
+#ifndef IFLA_BOND_SLAVE_MAX
+enum {
+	IFLA_BOND_SLAVE_UNSPEC,
+	IFLA_BOND_SLAVE_STATE,
+	IFLA_BOND_SLAVE_MII_STATUS,
+	IFLA_BOND_SLAVE_LINK_FAILURE_COUNT,
+	IFLA_BOND_SLAVE_PERM_HWADDR,
+	IFLA_BOND_SLAVE_QUEUE_ID,
+	IFLA_BOND_SLAVE_AD_AGGREGATOR_ID,
+	__IFLA_BOND_SLAVE_MAX,
+};
+#define IFLA_BOND_SLAVE_MAX	(__IFLA_BOND_SLAVE_MAX - 1)
+#endif
+
 #ifndef IFLA_XDP_MAX
 enum {
 	IFLA_XDP_UNSPEC,
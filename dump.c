@@ -0,0 +1,128 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "dump.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include "args.h"
+#include "netlink.h"
+#include "utils.h"
+
+#define DUMP_TABLES_MAX		256
+
+static int family = AF_UNSPEC;
+static unsigned int tables[DUMP_TABLES_MAX];
+static unsigned int table_count;
+
+static int set_family(char *arg)
+{
+	if (!strcmp(arg, "inet"))
+		family = AF_INET;
+	else if (!strcmp(arg, "inet6"))
+		family = AF_INET6;
+	else {
+		fprintf(stderr, "Unknown address family: %s\n", arg);
+		return EINVAL;
+	}
+	return 0;
+}
+
+static int add_route_table(char *arg)
+{
+	unsigned long table;
+	unsigned int i;
+	char *endptr;
+
+	if (!strcmp(arg, "main"))
+		table = RT_TABLE_MAIN;
+	else if (!strcmp(arg, "local"))
+		table = RT_TABLE_LOCAL;
+	else if (!strcmp(arg, "default"))
+		table = RT_TABLE_DEFAULT;
+	else {
+		table = strtoul(arg, &endptr, 10);
+		if (!*arg || *endptr || table == RT_TABLE_UNSPEC || table > RT_TABLE_MAX) {
+			fprintf(stderr, "Invalid route table: %s\n", arg);
+			return EINVAL;
+		}
+	}
+	for (i = 0; i < table_count; i++)
+		if (tables[i] == table)
+			return 0;
+	if (table_count == DUMP_TABLES_MAX) {
+		fprintf(stderr, "Too many route tables\n");
+		return EINVAL;
+	}
+	tables[table_count++] = table;
+	return 0;
+}
+
+static struct arg_option options[] = {
+	{ .long_name = "family", .short_name = '\0', .has_arg = 1,
+	  .type = ARG_CALLBACK, .action.callback = set_family,
+	  .help = "dump only addresses and routes of the family (inet, inet6)",
+	},
+	{ .long_name = "route-table", .short_name = '\0', .has_arg = 1,
+	  .type = ARG_CALLBACK, .action.callback = add_route_table,
+	  .help = "dump only routes of the table (number, main, local, default)",
+	},
+};
+
+void dump_register(void)
+{
+	arg_register_batch(options, ARRAY_SIZE(options));
+}
+
+int dump_family(void)
+{
+	return family;
+}
+
+unsigned int dump_route_tables(const unsigned int **res)
+{
+	*res = tables;
+	return table_count;
+}
+
+struct nlmsg *dump_addr_req(void)
+{
+	return rtnlmsg_new(RTM_GETADDR, family, NLM_F_DUMP, sizeof(struct ifaddrmsg));
+}
+
+struct nlmsg *dump_route_req(unsigned int table)
+{
+	struct rtmsg msg = {
+		.rtm_family = family,
+		/* the kernel reports tables above 255 as RT_TABLE_COMPAT */
+		.rtm_table = table < 256 ? table : RT_TABLE_COMPAT,
+	};
+	struct nlmsg *req;
+
+	req = nlmsg_new(RTM_GETROUTE, NLM_F_DUMP);
+	if (!req)
+		return NULL;
+	if (nlmsg_put(req, &msg, sizeof(msg)))
+		goto err;
+	if (table != RT_TABLE_UNSPEC && nla_put_u32(req, RTA_TABLE, table))
+		goto err;
+	return req;
+
+err:
+	nlmsg_free(req);
+	return NULL;
+}
@@ -0,0 +1,42 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _DUMP_H
+#define _DUMP_H
+
+struct nlmsg;
+
+/*
+ * Address and route dump requests. The address family and the route
+ * tables selected on the command line are passed to the kernel, which
+ * filters the dumps when the socket has NETLINK_GET_STRICT_CHK enabled.
+ * Older kernels ignore the table filter, the consumers thus have to
+ * check the table, too.
+ */
+void dump_register(void);
+
+/* Returns the selected address family, AF_UNSPEC for all. */
+int dump_family(void);
+
+/* Returns the number of the selected route tables and sets *tables to
+ * them. Zero means all tables. */
+unsigned int dump_route_tables(const unsigned int **tables);
+
+struct nlmsg *dump_addr_req(void);
+/* Cached routes (RTM_F_CLONED) are not requested. table is passed in
+ * RTA_TABLE and may be RT_TABLE_UNSPEC for all tables. */
+struct nlmsg *dump_route_req(unsigned int table);
+
+#endif
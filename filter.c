@@ -0,0 +1,211 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "filter.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "args.h"
+#include "list.h"
+#include "netns.h"
+#include "utils.h"
+
+enum filter_type {
+	FILTER_NAME,
+	FILTER_PID,
+	FILTER_CGROUP,
+	FILTER_INODE,
+};
+
+struct filter {
+	struct node n;
+	enum filter_type type;
+	char *pattern;		/* name glob or cgroup path */
+	unsigned long value;	/* pid or inode */
+};
+
+static DECLARE_LIST(includes);
+static DECLARE_LIST(excludes);
+static int need_cgroup;
+
+static int filter_add(struct list *list, char *arg)
+{
+	struct filter *f;
+	char *spec = arg, *endptr;
+
+	f = calloc(1, sizeof(*f));
+	if (!f)
+		return ENOMEM;
+	if (!strncmp(arg, "pid:", 4) || !strncmp(arg, "inode:", 6)) {
+		f->type = arg[0] == 'p' ? FILTER_PID : FILTER_INODE;
+		arg = strchr(arg, ':') + 1;
+		f->value = strtoul(arg, &endptr, 10);
+		if (!*arg || *endptr)
+			goto err_invalid;
+	} else if (!strncmp(arg, "cgroup:", 7)) {
+		f->type = FILTER_CGROUP;
+		f->pattern = arg + 7;
+		if (f->pattern[0] != '/')
+			goto err_invalid;
+		need_cgroup = 1;
+	} else {
+		f->type = FILTER_NAME;
+		if (!strncmp(arg, "name:", 5))
+			arg += 5;
+		f->pattern = arg;
+	}
+	list_append(list, node(f));
+	return 0;
+
+err_invalid:
+	fprintf(stderr, "Invalid name space filter: %s\n", spec);
+	free(f);
+	return EINVAL;
+}
+
+static int add_include(char *arg)
+{
+	return filter_add(&includes, arg);
+}
+
+static int add_exclude(char *arg)
+{
+	return filter_add(&excludes, arg);
+}
+
+static struct arg_option options[] = {
+	{ .long_name = "netns", .short_name = 'n', .has_arg = 1,
+	  .type = ARG_CALLBACK, .action.callback = add_include,
+	  .help = "scan only the matching name spaces",
+	},
+	{ .long_name = "exclude-netns", .short_name = '\0', .has_arg = 1,
+	  .type = ARG_CALLBACK, .action.callback = add_exclude,
+	  .help = "do not scan the matching name spaces",
+	},
+};
+
+void filter_register(void)
+{
+	arg_register_batch(options, ARRAY_SIZE(options));
+}
+
+void filter_cleanup(void)
+{
+	list_free(&includes, NULL);
+	list_free(&excludes, NULL);
+}
+
+int filter_active(void)
+{
+	return !list_empty(includes) || !list_empty(excludes);
+}
+
+/* Matches the path itself and everything below it. */
+static int cgroup_match(const char *cgroups, const char *path)
+{
+	size_t len = strlen(path);
+	const char *line, *s;
+
+	while (len > 1 && path[len - 1] == '/')
+		len--;
+	for (line = cgroups; *line; line = s + 1) {
+		/* hierarchy:controllers:path */
+		s = strchr(line, ':');
+		if (s)
+			s = strchr(s + 1, ':');
+		if (!s)
+			break;
+		s++;
+		if (len == 1 || (!strncmp(s, path, len) &&
+				 (s[len] == '/' || s[len] == '\n' || !s[len])))
+			return 1;
+		s = strchr(s, '\n');
+		if (!s)
+			break;
+	}
+	return 0;
+}
+
+static int filter_list_match_pid(struct list *list, pid_t pid, const char *cgroups)
+{
+	struct filter *f;
+
+	list_for_each(f, *list) {
+		if (f->type == FILTER_PID && f->value == (unsigned long)pid)
+			return 1;
+		if (f->type == FILTER_CGROUP && cgroups && cgroup_match(cgroups, f->pattern))
+			return 1;
+	}
+	return 0;
+}
+
+void filter_match_pid(struct netns_entry *ns, int procfd, pid_t pid)
+{
+	char buf[4096], path[32];
+	char *cgroups = NULL;
+	ssize_t len;
+	int fd;
+
+	if (need_cgroup) {
+		snprintf(path, sizeof(path), "%d/cgroup", pid);
+		fd = openat(procfd, path, O_RDONLY);
+		if (fd >= 0) {
+			len = read(fd, buf, sizeof(buf) - 1);
+			if (len >= 0) {
+				buf[len] = '\0';
+				cgroups = buf;
+			}
+			close(fd);
+		}
+	}
+	if (filter_list_match_pid(&includes, pid, cgroups))
+		ns->filter |= FILTER_INCLUDED;
+	if (filter_list_match_pid(&excludes, pid, cgroups))
+		ns->filter |= FILTER_EXCLUDED;
+}
+
+static int filter_list_match(struct list *list, struct netns_entry *ns)
+{
+	struct filter *f;
+
+	list_for_each(f, *list) {
+		if (f->type == FILTER_NAME && ns->name &&
+		    !fnmatch(f->pattern, ns->name, 0))
+			return 1;
+		if (f->type == FILTER_INODE && f->value == (unsigned long)ns->kernel_id)
+			return 1;
+	}
+	return 0;
+}
+
+int filter_selected(struct netns_entry *ns)
+{
+	if (filter_list_match(&includes, ns))
+		ns->filter |= FILTER_INCLUDED;
+	if (filter_list_match(&excludes, ns))
+		ns->filter |= FILTER_EXCLUDED;
+	return filter_allowed(ns);
+}
+
+int filter_allowed(const struct netns_entry *ns)
+{
+	if (ns->filter & FILTER_EXCLUDED)
+		return 0;
+	return list_empty(includes) || (ns->filter & FILTER_INCLUDED);
+}
@@ -0,0 +1,41 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _FILTER_H
+#define _FILTER_H
+
+#include <sys/types.h>
+
+struct netns_entry;
+
+/* values of netns_entry->filter */
+#define FILTER_INCLUDED		1
+#define FILTER_EXCLUDED		2
+
+void filter_register(void);
+void filter_cleanup(void);
+
+/* Returns nonzero if any name space filter was given. */
+int filter_active(void);
+/* Evaluates the pid and cgroup filters for a process found in the name
+ * space during the /proc walk. procfd is an fd of /proc. */
+void filter_match_pid(struct netns_entry *ns, int procfd, pid_t pid);
+/* Evaluates the remaining filters once the name space is fully discovered.
+ * Returns nonzero if the name space should be scanned. */
+int filter_selected(struct netns_entry *ns);
+/* Like filter_selected but does not evaluate the filters again. */
+int filter_allowed(const struct netns_entry *ns);
+
+#endif
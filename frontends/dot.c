@@ -15,6 +15,8 @@
 
 #include "dot.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <time.h>
 #include "../addr.h"
@@ -87,7 +89,7 @@ static int output_ifaces_pass1(FILE *f, struct list *list, unsigned int prop_mas
 		fprintf(f, "\"");
 
 		if (label_prop_match_mask(IF_PROP_STATE, prop_mask)) {
-			if (ptr->flags & IF_INTERNAL)
+			if (ptr->flags & (IF_INTERNAL | IF_STUB))
 				fprintf(f, ",style=dotted");
 			else if (!(ptr->flags & IF_UP))
 				fprintf(f, ",style=filled,fillcolor=\"grey\"");
@@ -107,6 +109,21 @@ static int output_ifaces_pass1(FILE *f, struct list *list, unsigned int prop_mas
 	return need_init_net;
 }
 
+/* Decides which side of a peer pair outputs the edge. This must not depend
+ * on the memory layout, so that the output is stable across runs. */
+static int output_peer_edge(struct if_entry *entry)
+{
+	char *id;
+	int res;
+
+	id = strdup(ifid(entry));
+	if (!id)
+		return (size_t) entry > (size_t) entry->peer;
+	res = strcmp(id, ifid(entry->peer)) > 0;
+	free(id);
+	return res;
+}
+
 static void output_ifaces_pass2(FILE *f, struct list *list)
 {
 	struct if_entry *ptr;
@@ -144,7 +161,7 @@ static void output_ifaces_pass2(FILE *f, struct list *list)
 			} else
 				fprintf(f, "\"%s\" -> \"cluster//\" [style=\"dashed\"]\n", ifid(ptr));
 		}
-		if (ptr->peer && (size_t) ptr > (size_t) ptr->peer) {
+		if (ptr->peer && output_peer_edge(ptr)) {
 			fprintf(f, "\"%s\" -> ", ifid(ptr));
 			fprintf(f, "\"%s\" [dir=none]\n", ifid(ptr->peer));
 		}
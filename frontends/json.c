@@ -147,10 +147,14 @@ static json_t *interfaces_to_array(struct list *list, struct output_entry *outpu
 		}
 		if (!entry->link_index && entry->link_net)
 			json_object_set_new(ifobj, "link-netns", link_netns(entry->link_net));
-		json_object_set_new(ifobj, "type", json_string(entry->flags & IF_INTERNAL ?
-							       "internal" :
-							       "device"));
-		if (entry->flags & IF_INTERNAL)
+		if (entry->flags & IF_STUB)
+			s = "stub";
+		else if (entry->flags & IF_INTERNAL)
+			s = "internal";
+		else
+			s = "device";
+		json_object_set_new(ifobj, "type", json_string(s));
+		if (entry->flags & (IF_INTERNAL | IF_STUB))
 			s = "none";
 		else if (!(entry->flags & IF_UP))
 			s = "down";
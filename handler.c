@@ -14,25 +14,39 @@
  */
 
 #include "handler.h"
+#include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include "if.h"
+#include "netlink.h"
 #include "netns.h"
 
+#include "compat.h"
+
 
 static DECLARE_LIST(if_handlers);
 static DECLARE_LIST(netns_handlers);
 static DECLARE_LIST(global_handlers);
+static unsigned int sources;
 
 void if_handler_register(struct if_handler *h)
 {
+	assert(h->data_max <= HANDLER_DATA_MAX &&
+	       h->slave_data_max <= HANDLER_DATA_MAX);
 	list_append(&if_handlers, node(h));
+	sources |= h->sources;
 }
 
 void netns_handler_register(struct netns_handler *h)
 {
 	list_append(&netns_handlers, node(h));
+	sources |= h->sources;
+}
+
+unsigned int handler_sources(void)
+{
+	return sources;
 }
 
 void global_handler_register(struct global_handler *h)
@@ -71,14 +85,46 @@ int if_handler_init(struct if_entry *entry)
 	return 0;
 }
 
+static int slave_match(struct if_handler *h, const char *kind)
+{
+	return h->slave_kind && kind && !strcmp(h->slave_kind, kind);
+}
+
+/* Parses the nested attribute into tb according to the policy. */
+static struct nlattr **handler_data(struct nlattr **tb, int max,
+				    const struct nla_policy *policy,
+				    const struct nlattr *nla)
+{
+	if (!nla || !policy)
+		return NULL;
+	nla_parse_nested(tb, max, policy, nla);
+	return tb;
+}
+
 int if_handler_netlink(struct if_entry *entry, struct nlattr **linkinfo)
 {
+	struct nlattr *tb[HANDLER_DATA_MAX + 1], **data;
+	const char *kind = NULL;
 	struct if_handler *h;
 	int err;
 
-	list_for_each(h, if_handlers)
-		if ((err = if_handler_callback(h, netlink, entry, linkinfo)))
-			return err;
+	if (linkinfo[IFLA_INFO_SLAVE_KIND])
+		kind = nla_read_str(linkinfo[IFLA_INFO_SLAVE_KIND]);
+
+	list_for_each(h, if_handlers) {
+		if (h->netlink && driver_match(h, entry)) {
+			data = handler_data(tb, h->data_max, h->data_policy,
+					    linkinfo[IFLA_INFO_DATA]);
+			if ((err = h->netlink(entry, linkinfo, data)))
+				return err;
+		}
+		if (h->slave_netlink && slave_match(h, kind)) {
+			data = handler_data(tb, h->slave_data_max, h->slave_data_policy,
+					    linkinfo[IFLA_INFO_SLAVE_DATA]);
+			if ((err = h->slave_netlink(entry, linkinfo, data)))
+				return err;
+		}
+	}
 
 	return 0;
 }
@@ -111,6 +157,18 @@ int if_handler_post(struct list *netns_list)
 	return 0;
 }
 
+struct addr *if_handler_tunnel_local(struct if_entry *entry)
+{
+	struct if_handler *h;
+	struct addr *res;
+
+	list_for_each(h, if_handlers)
+		if ((res = if_handler_callback(h, tunnel_local, entry)))
+			return res;
+
+	return NULL;
+}
+
 void if_handler_cleanup(struct if_entry *entry)
 {
 	struct if_handler *h;
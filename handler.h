@@ -19,9 +19,21 @@
 #include <stdio.h>
 #include "list.h"
 
+struct addr;
 struct if_entry;
 struct netns_entry;
 struct nlattr;
+struct nla_policy;
+
+/* Maximum data_max and slave_data_max. */
+#define HANDLER_DATA_MAX	63
+
+/* Data sources a handler reads, for the sources field. The core sets up
+ * only what the registered handlers need; sysfs is mounted on first use. */
+#define HANDLER_NETLINK		1
+#define HANDLER_SYSFS		2
+#define HANDLER_ETHTOOL		4
+#define HANDLER_DAEMON		8
 
 /* Only one handler for each driver allowed.
  * Generic handlers called for every interface are supported and are created
@@ -31,33 +43,61 @@ struct nlattr;
  * If you want to use handler_private, private_size bytes will be allocated
  * before any callback is called.
  *
+ * The IFLA_LINKINFO attributes are parsed once and the table (never NULL,
+ * empty if there is no IFLA_LINKINFO) is passed to all handlers.
+ * IFLA_INFO_DATA is parsed according to data_policy and passed to the
+ * netlink callback as data; similarly IFLA_INFO_SLAVE_DATA with
+ * slave_data_policy to slave_netlink. data is NULL if the attribute is
+ * missing or the handler has no policy.
+ *
  * Callbacks are called in this order:
  *   1. netlink - while reading interface data from netlink
+ *      slave_netlink - while reading data of an interface enslaved to
+ *      a master of slave_kind (IFLA_INFO_SLAVE_KIND); called for the slave,
+ *      which may have a different handler, thus handler_private must not
+ *      be used
  *   2. scan - while scanning interfaces, sysfs is mounted
  *   3. post - all interfaces are scanned, use this for inter-interface
  *      scanning
  *   4. cleanup - destroy private structure. handler_private itself will be
  *      freed automatically.
+ *
+ * tunnel_local may be called any time after netlink; it returns the local
+ * address of a tunnel or NULL, for following tunnels before post.
  */
 struct if_handler {
 	struct node n;
 	const char *driver;
+	const char *slave_kind;
+	unsigned int sources;
 	size_t private_size;
-	int (*netlink)(struct if_entry *entry, struct nlattr **linkinfo);
+	const struct nla_policy *data_policy;
+	int data_max;
+	const struct nla_policy *slave_data_policy;
+	int slave_data_max;
+	int (*netlink)(struct if_entry *entry, struct nlattr **linkinfo,
+		       struct nlattr **data);
+	int (*slave_netlink)(struct if_entry *entry, struct nlattr **linkinfo,
+			     struct nlattr **data);
 	int (*scan)(struct if_entry *entry);
 	int (*post)(struct if_entry *entry, struct list *netns_list);
 	void (*cleanup)(struct if_entry *entry);
+	struct addr *(*tunnel_local)(struct if_entry *entry);
 };
 
 void if_handler_register(struct if_handler *h);
+/* Returns the sources of all registered if and netns handlers. */
+unsigned int handler_sources(void);
 int if_handler_init(struct if_entry *entry);
 int if_handler_netlink(struct if_entry *entry, struct nlattr **linkinfo);
 int if_handler_scan(struct if_entry *entry);
 int if_handler_post(struct list *netns_list);
+struct addr *if_handler_tunnel_local(struct if_entry *entry);
 void if_handler_cleanup(struct if_entry *entry);
 
 struct netns_handler {
 	struct node n;
+	unsigned int sources;
 	int (*scan)(struct netns_entry *entry);
 	void (*cleanup)(struct netns_entry *entry);
 };
@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <linux/if_bonding.h>
 #include "../handler.h"
 #include "../if.h"
 #include "../netlink.h"
@@ -39,21 +40,51 @@ static const char *bond_mode_name[] = {
 	"balance-alb",
 };
 
+static const char *bond_link_state[] = {
+	"up",
+	"fail",
+	"down",
+	"back",
+};
+
 struct bond_private {
+	int netlink;
 	uint8_t mode;
 	unsigned int active_slave_index;
 	char *active_slave_name;
 };
 
-static int bond_netlink(struct if_entry *entry, struct nlattr **linkinfo);
+static int bond_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			struct nlattr **data);
+static int bond_slave_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			      struct nlattr **data);
 static int bond_scan(struct if_entry *entry);
 static int bond_post(struct if_entry *entry, struct list *netns_list);
 static void bond_cleanup(struct if_entry *entry);
 
+static const struct nla_policy bond_policy[IFLA_BOND_MAX + 1] = {
+	[IFLA_BOND_MODE] = { .type = NLA_U8 },
+	[IFLA_BOND_ACTIVE_SLAVE] = { .type = NLA_U32 },
+};
+
+static const struct nla_policy bond_slave_policy[IFLA_BOND_SLAVE_MAX + 1] = {
+	[IFLA_BOND_SLAVE_STATE] = { .type = NLA_U8 },
+	[IFLA_BOND_SLAVE_MII_STATUS] = { .type = NLA_U8 },
+	[IFLA_BOND_SLAVE_LINK_FAILURE_COUNT] = { .type = NLA_U32 },
+	[IFLA_BOND_SLAVE_AD_AGGREGATOR_ID] = { .type = NLA_U16 },
+};
+
 static struct if_handler h_bond = {
 	.driver = "bonding",
+	.slave_kind = "bond",
+	.sources = HANDLER_NETLINK | HANDLER_SYSFS,
 	.private_size = sizeof(struct bond_private),
+	.data_policy = bond_policy,
+	.data_max = IFLA_BOND_MAX,
+	.slave_data_policy = bond_slave_policy,
+	.slave_data_max = IFLA_BOND_SLAVE_MAX,
 	.netlink = bond_netlink,
+	.slave_netlink = bond_slave_netlink,
 	.scan = bond_scan,
 	.post = bond_post,
 	.cleanup = bond_cleanup,
@@ -64,18 +95,17 @@ void handler_bond_register(void)
 	if_handler_register(&h_bond);
 }
 
-static int bond_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int bond_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			struct nlattr **bondinfo)
 {
 	struct bond_private *priv = entry->handler_private;
-	struct nlattr **bondinfo;
 
-	if (!linkinfo || !linkinfo[IFLA_INFO_DATA])
-		return ENOENT;
-	bondinfo = nla_nested_attrs(linkinfo[IFLA_INFO_DATA], IFLA_BOND_MAX);
 	if (!bondinfo)
-		return ENOMEM;
+		return ENOENT;
 
 	if (bondinfo[IFLA_BOND_MODE]) {
+		/* the kernel reports the active slave along with the mode */
+		priv->netlink = 1;
 		priv->mode = nla_read_u8(bondinfo[IFLA_BOND_MODE]) + 1;
 		if (priv->mode >= ARRAY_SIZE(bond_mode_name))
 			priv->mode = 0;
@@ -85,30 +115,57 @@ static int bond_netlink(struct if_entry *entry, struct nlattr **linkinfo)
 		priv->active_slave_index = nla_read_u32(bondinfo[IFLA_BOND_ACTIVE_SLAVE]);
 	}
 
-	free(bondinfo);
 	return 0;
 }
 
-static ssize_t bond_get_sysfs(char **dest, struct if_entry *entry, const char *prop)
+static int bond_slave_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			      struct nlattr **slaveinfo)
 {
-	char *path;
-	ssize_t len;
+	unsigned int val;
+
+	if (!slaveinfo)
+		return 0;
 
-	*dest = NULL;
-	if (asprintf(&path, "class/net/%s/bonding/%s", entry->if_name, prop) < 0)
-		return -errno;
+	if (slaveinfo[IFLA_BOND_SLAVE_STATE] &&
+	    nla_read_u8(slaveinfo[IFLA_BOND_SLAVE_STATE]) == BOND_STATE_BACKUP)
+		entry->flags |= IF_PASSIVE_SLAVE;
 
-	len = sysfs_readfile(dest, path);
-	free(path);
-	if (len < 0) {
-		if (len == -ENOENT)
-			return 0;
-		return len;
+	if (slaveinfo[IFLA_BOND_SLAVE_MII_STATUS]) {
+		val = nla_read_u8(slaveinfo[IFLA_BOND_SLAVE_MII_STATUS]);
+		if (val >= ARRAY_SIZE(bond_link_state))
+			if_add_state(entry, "mii status", "%u", val);
+		else if (val != BOND_LINK_UP)
+			if_add_state(entry, "mii status", "%s", bond_link_state[val]);
 	}
 
-	if (len == 0)
-		free(dest);
+	if (slaveinfo[IFLA_BOND_SLAVE_LINK_FAILURE_COUNT]) {
+		val = nla_read_u32(slaveinfo[IFLA_BOND_SLAVE_LINK_FAILURE_COUNT]);
+		if (val)
+			if_add_state(entry, "link failures", "%u", val);
+	}
+
+	/* present in 802.3ad mode only */
+	if (slaveinfo[IFLA_BOND_SLAVE_AD_AGGREGATOR_ID])
+		if_add_state(entry, "aggregator", "%u",
+			     nla_read_u16(slaveinfo[IFLA_BOND_SLAVE_AD_AGGREGATOR_ID]));
+
+	return 0;
+}
 
+static ssize_t bond_get_sysfs(char *buf, size_t size, struct if_entry *entry,
+			      const char *prop)
+{
+	char path[sizeof("bonding/") + 16];
+	ssize_t len;
+	int dir;
+
+	dir = sysfs_if_dir(entry->if_name);
+	if (dir < 0)
+		return dir == -ENOENT ? 0 : dir;
+	snprintf(path, sizeof(path), "bonding/%s", prop);
+	len = sysfs_read_at(dir, path, buf, size);
+	if (len == -ENOENT)
+		return 0;
 	return len;
 }
 
@@ -125,22 +182,26 @@ static int match_active_slave(struct if_entry *entry, struct if_entry *master)
 
 static int bond_scan(struct if_entry *entry)
 {
-	char *dest, *tmp;
 	struct bond_private *priv = entry->handler_private;
+	char buf[64], *tmp;
+
+	/* sysfs is needed only with kernels without bonding netlink support */
+	if (priv->netlink)
+		return 0;
 
 	if (!priv->mode) {
-		if (bond_get_sysfs(&dest, entry, "mode") > 0) {
-			tmp = index(dest, ' ');
+		if (bond_get_sysfs(buf, sizeof(buf), entry, "mode") > 0) {
+			tmp = index(buf, ' ');
 			if (tmp)
 				priv->mode = atoi(tmp + 1) + 1;
-			free(dest);
 		}
 		if (priv->mode >= ARRAY_SIZE(bond_mode_name))
 			priv->mode = 0;
 	}
 
-	if (!priv->active_slave_index)
-		bond_get_sysfs(&priv->active_slave_name, entry, "active_slave");
+	if (!priv->active_slave_index &&
+	    bond_get_sysfs(buf, sizeof(buf), entry, "active_slave") > 0)
+		priv->active_slave_name = strdup(buf);
 
 	return 0;
 }
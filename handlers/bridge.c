@@ -15,43 +15,173 @@
 
 #include "bridge.h"
 #include <errno.h>
-#include <net/if.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <linux/if_bridge.h>
+#include <net/if.h>
+#include "../batch.h"
 #include "../handler.h"
 #include "../if.h"
+#include "../netlink.h"
+#include "../netns.h"
 #include "../sysfs.h"
+#include "../utils.h"
+
+#include "../compat.h"
+
+static const char *bridge_port_state[] = {
+	"disabled",
+	"listening",
+	"learning",
+	"forwarding",
+	"blocking",
+};
 
-static int bridge_scan(struct if_entry *entry);
+/* Set when a bridge port in the name space being scanned by this thread
+ * came with IFLA_INFO_SLAVE_KIND, i.e. the kernel reports the bridge ports
+ * in the link dump. */
+static __thread struct netns_entry *bridge_ports_ns;
+
+static int bridge_slave_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+				struct nlattr **data);
+static int bridge_scan(struct netns_entry *ns);
+
+static const struct nla_policy brport_policy[IFLA_BRPORT_BCAST_FLOOD + 1] = {
+	[IFLA_BRPORT_STATE] = { .type = NLA_U8 },
+	[IFLA_BRPORT_LEARNING] = { .type = NLA_U8 },
+	[IFLA_BRPORT_UNICAST_FLOOD] = { .type = NLA_U8 },
+	[IFLA_BRPORT_MCAST_FLOOD] = { .type = NLA_U8 },
+	[IFLA_BRPORT_BCAST_FLOOD] = { .type = NLA_U8 },
+};
 
 static struct if_handler h_bridge = {
+	.driver = "bridge",
+	.slave_kind = "bridge",
+	.sources = HANDLER_NETLINK,
+	.slave_data_policy = brport_policy,
+	.slave_data_max = IFLA_BRPORT_BCAST_FLOOD,
+	.slave_netlink = bridge_slave_netlink,
+};
+
+static struct netns_handler h_bridge_ns = {
+	.sources = HANDLER_SYSFS,
 	.scan = bridge_scan,
 };
 
 void handler_bridge_register(void)
 {
 	if_handler_register(&h_bridge);
+	netns_handler_register(&h_bridge_ns);
 }
 
-static int bridge_scan(struct if_entry *entry)
+static void bridge_port_flag(struct if_entry *entry, struct nlattr **brport,
+			     int attr, const char *key)
 {
-	int len;
-	char path [33 + IFNAMSIZ + 1];
-	char *ifindex;
+	if (brport[attr] && !nla_read_u8(brport[attr]))
+		if_add_config(entry, key, "off");
+}
 
-	if (entry->master_index)
-		return 0;
+static int bridge_slave_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+				struct nlattr **brport)
+{
+	unsigned int state;
 
-	snprintf(path, sizeof(path), "/class/net/%s/brport/bridge/ifindex", entry->if_name);
+	bridge_ports_ns = entry->ns;
+	if (!brport)
+		return 0;
 
-	len = sysfs_readfile(&ifindex, path);
-	if (len < 0) {
-		if (len == -ENOENT)
-			return 0;
-		return -len;
+	/* only the states other than the default are shown */
+	if (brport[IFLA_BRPORT_STATE]) {
+		state = nla_read_u8(brport[IFLA_BRPORT_STATE]);
+		if (state >= ARRAY_SIZE(bridge_port_state))
+			if_add_state(entry, "stp state", "%u", state);
+		else if (state != BR_STATE_FORWARDING)
+			if_add_state(entry, "stp state", "%s", bridge_port_state[state]);
 	}
+	bridge_port_flag(entry, brport, IFLA_BRPORT_LEARNING, "learning");
+	bridge_port_flag(entry, brport, IFLA_BRPORT_UNICAST_FLOOD, "unicast flood");
+	bridge_port_flag(entry, brport, IFLA_BRPORT_MCAST_FLOOD, "multicast flood");
+	bridge_port_flag(entry, brport, IFLA_BRPORT_BCAST_FLOOD, "broadcast flood");
+
+	return 0;
+}
 
-	entry->master_index = atoi(ifindex);
-	free(ifindex);
+/* Returns nonzero if a port of a bridge in ns is known but none came with
+ * IFLA_INFO_SLAVE_KIND. Only the bridges count, other masters (e.g. the
+ * openvswitch ports) do not have a slave kind even on current kernels. */
+static int bridge_old_kernel(struct netns_entry *ns)
+{
+	struct if_entry *br, *entry;
+
+	if (bridge_ports_ns == ns)
+		return 0;
+	list_for_each(br, ns->ifaces) {
+		if (!br->driver || strcmp(br->driver, "bridge"))
+			continue;
+		list_for_each(entry, ns->ifaces)
+			if (entry->master_index == br->if_index)
+				return 1;
+	}
 	return 0;
 }
+
+struct bridge_brport {
+	struct if_entry *entry;
+	char path[sizeof("class/net//brport/bridge/ifindex") + IFNAMSIZ];
+	char ifindex[16];
+};
+
+/* Fallback for kernels that do not report the bridge ports in the link
+ * dump. Looked at only if such a kernel was detected from the ports of
+ * a bridge in the name space. The brport files of all interfaces are read
+ * in one batch; an interface whose file cannot be read is not a port. */
+static int bridge_scan(struct netns_entry *ns)
+{
+	struct bridge_brport *ports;
+	struct batch_read *reqs;
+	struct if_entry *entry;
+	unsigned int i, count = 0;
+	int root, err = 0;
+
+	if (!bridge_old_kernel(ns))
+		return 0;
+	list_for_each(entry, ns->ifaces)
+		if (!entry->master_index)
+			count++;
+	if (!count)
+		return 0;
+
+	root = sysfs_root();
+	if (root < 0)
+		return -root;
+	reqs = calloc(count, sizeof(*reqs));
+	ports = calloc(count, sizeof(*ports));
+	if (!reqs || !ports) {
+		err = ENOMEM;
+		goto out;
+	}
+
+	i = 0;
+	list_for_each(entry, ns->ifaces) {
+		if (entry->master_index)
+			continue;
+		ports[i].entry = entry;
+		snprintf(ports[i].path, sizeof(ports[i].path),
+			 "class/net/%s/brport/bridge/ifindex", entry->if_name);
+		reqs[i].dirfd = root;
+		reqs[i].path = ports[i].path;
+		reqs[i].buf = ports[i].ifindex;
+		reqs[i].size = sizeof(ports[i].ifindex);
+		i++;
+	}
+	batch_read(reqs, count);
+	for (i = 0; i < count; i++)
+		if (reqs[i].res > 0)
+			ports[i].entry->master_index = atoi(ports[i].ifindex);
+
+out:
+	free(reqs);
+	free(ports);
+	return err;
+}
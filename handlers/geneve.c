@@ -34,11 +34,23 @@ struct geneve_priv {
 	int flags;
 };
 
-static int geneve_netlink(struct if_entry *entry, struct nlattr **linkinfo);
+static int geneve_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			  struct nlattr **data);
+
+static const struct nla_policy geneve_policy[IFLA_GENEVE_MAX + 1] = {
+	[IFLA_GENEVE_ID] = { .type = NLA_U32 },
+	[IFLA_GENEVE_REMOTE] = { .type = NLA_BINARY, .len = 4 },
+	[IFLA_GENEVE_PORT] = { .type = NLA_U16 },
+	[IFLA_GENEVE_COLLECT_METADATA] = { .type = NLA_UNSPEC },
+	[IFLA_GENEVE_REMOTE6] = { .type = NLA_BINARY, .len = 16 },
+};
 
 static struct if_handler h_geneve = {
 	.driver = "geneve",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct geneve_priv),
+	.data_policy = geneve_policy,
+	.data_max = IFLA_GENEVE_MAX,
 	.netlink = geneve_netlink,
 };
 
@@ -47,9 +59,9 @@ void handler_geneve_register(void)
 	if_handler_register(&h_geneve);
 }
 
-static int geneve_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int geneve_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			  struct nlattr **geneveinfo)
 {
-	struct nlattr **geneveinfo;
 	uint16_t port;
 	struct geneve_priv *priv;
 	int err;
@@ -61,13 +73,8 @@ static int geneve_netlink(struct if_entry *entry, struct nlattr **linkinfo)
 	}
 	entry->handler_private = priv;
 
-	if (!linkinfo || !linkinfo[IFLA_INFO_DATA]) {
-		err = ENOENT;
-		goto err_priv;
-	}
-	geneveinfo = nla_nested_attrs(linkinfo[IFLA_INFO_DATA], IFLA_GENEVE_MAX);
 	if (!geneveinfo) {
-		err = ENOMEM;
+		err = ENOENT;
 		goto err_priv;
 	}
 
@@ -83,7 +90,7 @@ static int geneve_netlink(struct if_entry *entry, struct nlattr **linkinfo)
 	if (geneveinfo[IFLA_GENEVE_REMOTE]) {
 		struct addr addr;
 		if ((err = addr_init(&addr, AF_INET, -1, nla_read(geneveinfo[IFLA_GENEVE_REMOTE]))))
-			goto err_attrs;
+			goto err_priv;
 		if (!addr_is_zero(&addr))
 			if_add_config(entry, "remote", "%s", addr.formatted);
 		addr_destruct(&addr);
@@ -92,7 +99,7 @@ static int geneve_netlink(struct if_entry *entry, struct nlattr **linkinfo)
 	if (geneveinfo[IFLA_GENEVE_REMOTE6]) {
 		struct addr addr;
 		if ((err = addr_init(&addr, AF_INET6, -1, nla_read(geneveinfo[IFLA_GENEVE_REMOTE6]))))
-			goto err_attrs;
+			goto err_priv;
 		if (!addr_is_zero(&addr))
 			if_add_config(entry, "remote6", "%s", addr.formatted);
 		addr_destruct(&addr);
@@ -101,11 +108,8 @@ static int geneve_netlink(struct if_entry *entry, struct nlattr **linkinfo)
 	if (geneveinfo[IFLA_GENEVE_COLLECT_METADATA])
 		if_add_config(entry, "mode", "external");
 
-	free(geneveinfo);
 	return 0;
 
-err_attrs:
-	free(geneveinfo);
 err_priv:
 	free(priv);
 err:
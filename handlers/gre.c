@@ -27,54 +27,93 @@
 #include "../tunnel.h"
 #include "../netns.h"
 
-static int gre_netlink(struct if_entry *entry, struct nlattr **linkinfo);
-static int gre6_netlink(struct if_entry *entry, struct nlattr **linkinfo);
+static int gre_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+		       struct nlattr **data);
+static int gre6_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			struct nlattr **data);
 static int gre_post(struct if_entry *entry, struct list *netns_list);
+static struct addr *gre_tunnel_local(struct if_entry *entry);
 
 struct gre_priv {
 	struct addr local;
 };
 
+#define GRE_POLICY(addr_len)						\
+	{								\
+		[IFLA_GRE_LINK] = { .type = NLA_U32 },			\
+		[IFLA_GRE_IKEY] = { .type = NLA_U32 },			\
+		[IFLA_GRE_OKEY] = { .type = NLA_U32 },			\
+		[IFLA_GRE_LOCAL] = { .type = NLA_BINARY, .len = addr_len }, \
+		[IFLA_GRE_REMOTE] = { .type = NLA_BINARY, .len = addr_len }, \
+	}
+
+static const struct nla_policy gre_policy[IFLA_GRE_MAX + 1] = GRE_POLICY(4);
+static const struct nla_policy gre6_policy[IFLA_GRE_MAX + 1] = GRE_POLICY(16);
+
 static struct if_handler h_gre = {
 	.driver = "gre",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct gre_priv),
+	.data_policy = gre_policy,
+	.data_max = IFLA_GRE_MAX,
 	.netlink = gre_netlink,
 	.post = gre_post,
+	.tunnel_local = gre_tunnel_local,
 };
 
 static struct if_handler h_gretap = {
 	.driver = "gretap",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct gre_priv),
+	.data_policy = gre_policy,
+	.data_max = IFLA_GRE_MAX,
 	.netlink = gre_netlink,
 	.post = gre_post,
+	.tunnel_local = gre_tunnel_local,
 };
 
 static struct if_handler h_erspan = {
 	.driver = "erspan",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct gre_priv),
+	.data_policy = gre_policy,
+	.data_max = IFLA_GRE_MAX,
 	.netlink = gre_netlink,
 	.post = gre_post,
+	.tunnel_local = gre_tunnel_local,
 };
 
 static struct if_handler h_ip6gre = {
 	.driver = "ip6gre",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct gre_priv),
+	.data_policy = gre6_policy,
+	.data_max = IFLA_GRE_MAX,
 	.netlink = gre6_netlink,
 	.post = gre_post,
+	.tunnel_local = gre_tunnel_local,
 };
 
 static struct if_handler h_ip6gretap = {
 	.driver = "ip6gretap",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct gre_priv),
+	.data_policy = gre6_policy,
+	.data_max = IFLA_GRE_MAX,
 	.netlink = gre6_netlink,
 	.post = gre_post,
+	.tunnel_local = gre_tunnel_local,
 };
 
 static struct if_handler h_ip6erspan = {
 	.driver = "ip6erspan",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct gre_priv),
+	.data_policy = gre6_policy,
+	.data_max = IFLA_GRE_MAX,
 	.netlink = gre6_netlink,
 	.post = gre_post,
+	.tunnel_local = gre_tunnel_local,
 };
 
 void handler_gre_register(void)
@@ -87,13 +126,12 @@ void handler_gre_register(void)
 	if_handler_register(&h_ip6erspan);
 }
 
-static int gre_common_netlink(int family, struct if_entry *entry, struct nlattr **linkinfo)
+static int gre_common_netlink(int family, struct if_entry *entry, struct nlattr **greinfo)
 {
-	struct nlattr **greinfo;
 	struct gre_priv *priv;
 	int err, key;
 
-	if (!linkinfo || !linkinfo[IFLA_INFO_DATA])
+	if (!greinfo)
 		return ENOENT;
 
 	priv = calloc(1, sizeof(struct gre_priv));
@@ -101,16 +139,10 @@ static int gre_common_netlink(int family, struct if_entry *entry, struct nlattr
 		return ENOMEM;
 	entry->handler_private = priv;
 
-	greinfo = nla_nested_attrs(linkinfo[IFLA_INFO_DATA], IFLA_GRE_MAX);
-	if (!greinfo) {
-		err = ENOMEM;
-		goto err_priv;
-	}
-
 	priv->local.family = -1;
 	if (greinfo[IFLA_GRE_LOCAL]) {
 		if ((err = addr_init(&priv->local, family, -1, nla_read(greinfo[IFLA_GRE_LOCAL]))))
-			goto err_attrs;
+			goto err_priv;
 		if (!addr_is_zero(&priv->local))
 			if_add_config(entry, "local", "%s", priv->local.formatted);
 	}
@@ -118,14 +150,14 @@ static int gre_common_netlink(int family, struct if_entry *entry, struct nlattr
 	if (greinfo[IFLA_GRE_REMOTE]) {
 		struct addr addr;
 		if ((err = addr_init(&addr, family, -1, nla_read(greinfo[IFLA_GRE_REMOTE]))))
-			goto err_attrs;
+			goto err_priv;
 		if (!addr_is_zero(&addr))
 			if_add_config(entry, "remote", "%s", addr.formatted);
 		addr_destruct(&addr);
 	}
 
 	if (greinfo[IFLA_GRE_LINK])
-		entry->link_index = nla_read_u8(greinfo[IFLA_GRE_LINK]);
+		entry->link_index = nla_read_u32(greinfo[IFLA_GRE_LINK]);
 
 	if (greinfo[IFLA_GRE_IKEY]) {
 		if ((key = nla_read_u32(greinfo[IFLA_GRE_IKEY])))
@@ -136,24 +168,23 @@ static int gre_common_netlink(int family, struct if_entry *entry, struct nlattr
 		if ((key = nla_read_u32(greinfo[IFLA_GRE_OKEY])))
 			if_add_config(entry, "okey", "%u", ntohl(key));
 
-	free(greinfo);
 	return 0;
 
-err_attrs:
-	free(greinfo);
 err_priv:
 	free(priv);
 	return err;
 }
 
-static int gre_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int gre_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+		       struct nlattr **data)
 {
-	return gre_common_netlink(AF_INET, entry, linkinfo);
+	return gre_common_netlink(AF_INET, entry, data);
 }
 
-static int gre6_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int gre6_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			struct nlattr **data)
 {
-	return gre_common_netlink(AF_INET6, entry, linkinfo);
+	return gre_common_netlink(AF_INET6, entry, data);
 }
 
 static int gre_post(struct if_entry *entry, _unused struct list *netns_list)
@@ -173,3 +204,10 @@ static int gre_post(struct if_entry *entry, _unused struct list *netns_list)
 
 	return 0;
 }
+
+static struct addr *gre_tunnel_local(struct if_entry *entry)
+{
+	struct gre_priv *priv = entry->handler_private;
+
+	return priv->local.family >= 0 ? &priv->local : NULL;
+}
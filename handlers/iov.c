@@ -15,104 +15,176 @@
 
 #include "iov.h"
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "../handler.h"
+#include "../hash.h"
 #include "../if.h"
-#include "../match.h"
+#include "../netns.h"
 #include "../sysfs.h"
 
-struct netns_entry;
+struct iov_pf {
+	struct hnode h;
+	struct if_entry *entry;
+};
 
 static int iov_scan(struct if_entry *entry);
-static int iov_post(struct if_entry *entry, struct list *netns_list);
+static int iov_post(struct list *netns_list);
 static void iov_cleanup(struct if_entry *entry);
 
 static struct if_handler h_iov = {
+	.sources = HANDLER_SYSFS,
 	.scan = iov_scan,
-	.post = iov_post,
 	.cleanup = iov_cleanup,
 };
 
+static struct global_handler gh_iov = {
+	.post = iov_post,
+};
+
 void handler_iov_register(void)
 {
 	if_handler_register(&h_iov);
+	global_handler_register(&gh_iov);
 }
 
-static int iov_scan(struct if_entry *entry)
+/* Switchdev representors of VFs are named pfXvfY by the kernel. Their
+ * parent device is the PF. */
+static int iov_representor(struct if_entry *entry)
 {
-	char *resolved;
-	char *path;
+	unsigned int pf, vf;
+	char c;
 
-	if (asprintf(&path, "class/net/%s/device", entry->if_name) < 0)
-		return errno;
+	return entry->phys_port_name &&
+	       sscanf(entry->phys_port_name, "pf%uvf%u%c", &pf, &vf, &c) == 2;
+}
 
-	resolved = sysfs_realpath(path);
-	free(path);
+static int iov_set_path(char **dest, const char *path)
+{
+	const char *p = strrchr(path, '/');
 
-	if (resolved) {
-		entry->pci_path = resolved;
-	} else {
-		if (errno == ENOENT)
-			return 0; /* this is not a PCI device */
-		return errno;
-	}
+	*dest = strdup(p ? p + 1 : path);
+	if (!*dest)
+		return ENOMEM;
+	return 0;
+}
 
-	if (asprintf(&path, "class/net/%s/device/physfn", entry->if_name) < 0)
-		return errno;
+static int iov_scan(struct if_entry *entry)
+{
+	char buf[PATH_MAX];
+	ssize_t len;
+	int dir, err;
 
-	resolved = sysfs_realpath(path);
-	free(path);
+	/* known from the link dump not to be a PCI function */
+	if (entry->pci_known && !entry->pci_path)
+		return 0;
+	if (iov_representor(entry))
+		return 0;
 
-	if (resolved) {
-		entry->pci_physfn_path = resolved;
-	} else {
-		if (errno == ENOENT)
-			return 0; /* this is not a VF */
-		return errno;
+	dir = sysfs_if_dir(entry->if_name);
+	if (dir < 0)
+		return dir == -ENOENT ? 0 : -dir;
+
+	if (!entry->pci_path) {
+		len = sysfs_realpath_at(dir, "device", buf, sizeof(buf));
+		if (len < 0) {
+			if (len == -ENOENT)
+				return 0; /* this is not a PCI device */
+			return -len;
+		}
+		if ((err = iov_set_path(&entry->pci_path, buf)))
+			return err;
 	}
 
-	return 0;
+	len = sysfs_realpath_at(dir, "device/physfn", buf, sizeof(buf));
+	if (len < 0) {
+		if (len == -ENOENT)
+			return 0; /* this is not a VF */
+		return -len;
+	}
+	return iov_set_path(&entry->pci_physfn_path, buf);
 }
 
-static int match_physfn(struct if_entry *physfn, void *arg)
+static int iov_pci_key(const char *addr, unsigned long *key)
 {
-	struct if_entry *entry = arg;
+	unsigned int domain, bus, dev, fn;
 
-	if (!physfn->pci_path)
+	if (sscanf(addr, "%x:%x:%x.%x", &domain, &bus, &dev, &fn) != 4)
 		return 0;
+	*key = (unsigned long)domain << 16 | bus << 8 | dev << 3 | fn;
+	return 1;
+}
 
-	if (!strcmp(physfn->pci_path, entry->pci_physfn_path))
-		return 1;
+static struct if_entry *iov_find_pf(struct hash *pfs, const char *addr)
+{
+	struct iov_pf *pf;
+	unsigned long key;
 
-	return 0;
+	if (!iov_pci_key(addr, &key))
+		return NULL;
+	pf = hash_entry(hash_find(pfs, key), struct iov_pf, h);
+	return pf ? pf->entry : NULL;
 }
 
-static int iov_post(struct if_entry *entry, struct list *netns_list)
+/* Indexes all PCI functions that are not VFs by their address, then
+ * resolves the VFs and the representors in a single pass. */
+static int iov_post(struct list *netns_list)
 {
-	struct match_desc match;
+	struct hash pfs = HASH_INITIALIZER;
+	struct netns_entry *ns;
+	struct if_entry *entry;
+	struct iov_pf *pf;
+	unsigned long key;
 	int err = 0;
 
-	if (entry->physfn || !entry->pci_physfn_path)
-		return 0;
+	list_for_each(ns, *netns_list) {
+		list_for_each(entry, ns->ifaces) {
+			if (!entry->pci_path || entry->pci_physfn_path ||
+			    iov_representor(entry))
+				continue;
+			/* with more interfaces per function, the first wins */
+			if (!iov_pci_key(entry->pci_path, &key) || hash_find(&pfs, key))
+				continue;
+			pf = malloc(sizeof(*pf));
+			if (!pf) {
+				err = ENOMEM;
+				goto out;
+			}
+			pf->entry = entry;
+			if ((err = hash_add(&pfs, &pf->h, key))) {
+				free(pf);
+				goto out;
+			}
+		}
+	}
 
-	match_init(&match);
-	match.mode = MM_FIRST;
-	match.netns_list = netns_list;
-	match.exclude = entry;
-	if ((err = match_if(&match, match_physfn, entry)))
-		return err;
-	if (!(entry->physfn = match_found(match)))
-		return if_add_warning(entry, "failed to find the iov physfn");
-	return 0;
+	list_for_each(ns, *netns_list) {
+		list_for_each(entry, ns->ifaces) {
+			if (entry->physfn)
+				continue;
+			if (entry->pci_physfn_path) {
+				entry->physfn = iov_find_pf(&pfs, entry->pci_physfn_path);
+				if (!entry->physfn &&
+				    (err = if_add_warning(entry, "failed to find the iov physfn")))
+					goto out;
+			} else if (entry->pci_path && iov_representor(entry)) {
+				entry->physfn = iov_find_pf(&pfs, entry->pci_path);
+			}
+		}
+	}
+
+out:
+	hash_free_all(&pfs, NULL);
+	return err;
 }
 
 static void iov_cleanup(struct if_entry *entry)
 {
 	if (entry->pci_path)
-		sysfs_free(entry->pci_path);
+		free(entry->pci_path);
 
 	if (entry->pci_physfn_path)
-		sysfs_free(entry->pci_physfn_path);
+		free(entry->pci_physfn_path);
 }
@@ -27,34 +27,61 @@
 #include "../tunnel.h"
 #include "../netns.h"
 
-static int ipip_netlink(struct if_entry *entry, struct nlattr **linkinfo);
-static int ipxip6_netlink(struct if_entry *entry, struct nlattr **linkinfo);
-static int sit_netlink(struct if_entry *entry, struct nlattr **linkinfo);
+static int ipip_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			struct nlattr **data);
+static int ipxip6_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			  struct nlattr **data);
+static int sit_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+		       struct nlattr **data);
 static int ipxipy_post(struct if_entry *entry, struct list *netns_list);
+static struct addr *ipxipy_tunnel_local(struct if_entry *entry);
 
 struct ipxipy_priv {
 	struct addr local;
 };
 
+#define IPTUN_POLICY(addr_len)						\
+	{								\
+		[IFLA_IPTUN_LINK] = { .type = NLA_U32 },		\
+		[IFLA_IPTUN_LOCAL] = { .type = NLA_BINARY, .len = addr_len }, \
+		[IFLA_IPTUN_REMOTE] = { .type = NLA_BINARY, .len = addr_len }, \
+		[IFLA_IPTUN_PROTO] = { .type = NLA_U8 },		\
+	}
+
+static const struct nla_policy iptun_policy[IFLA_IPTUN_MAX + 1] = IPTUN_POLICY(4);
+static const struct nla_policy ip6tun_policy[IFLA_IPTUN_MAX + 1] = IPTUN_POLICY(16);
+
 static struct if_handler h_ipip = {
 	.driver = "ipip",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct ipxipy_priv),
+	.data_policy = iptun_policy,
+	.data_max = IFLA_IPTUN_MAX,
 	.netlink = ipip_netlink,
 	.post = ipxipy_post,
+	.tunnel_local = ipxipy_tunnel_local,
 };
 
 static struct if_handler h_sit = {
 	.driver = "sit",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct ipxipy_priv),
+	.data_policy = iptun_policy,
+	.data_max = IFLA_IPTUN_MAX,
 	.netlink = sit_netlink,
 	.post = ipxipy_post,
+	.tunnel_local = ipxipy_tunnel_local,
 };
 
 static struct if_handler h_ip6tnl = {
 	.driver = "ip6tnl",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct ipxipy_priv),
+	.data_policy = ip6tun_policy,
+	.data_max = IFLA_IPTUN_MAX,
 	.netlink = ipxip6_netlink,
 	.post = ipxipy_post,
+	.tunnel_local = ipxipy_tunnel_local,
 };
 
 void handler_ipxipy_register(void)
@@ -64,13 +91,12 @@ void handler_ipxipy_register(void)
 	if_handler_register(&h_ip6tnl);
 }
 
-static int ipxipy_netlink(int family, struct if_entry *entry, struct nlattr **linkinfo)
+static int ipxipy_netlink(int family, struct if_entry *entry, struct nlattr **info)
 {
-	struct nlattr **info;
 	struct ipxipy_priv *priv;
 	int err;
 
-	if (!linkinfo || !linkinfo[IFLA_INFO_DATA])
+	if (!info)
 		return ENOENT;
 
 	priv = calloc(1, sizeof(struct ipxipy_priv));
@@ -78,16 +104,10 @@ static int ipxipy_netlink(int family, struct if_entry *entry, struct nlattr **li
 		return ENOMEM;
 	entry->handler_private = priv;
 
-	info = nla_nested_attrs(linkinfo[IFLA_INFO_DATA], IFLA_IPTUN_MAX);
-	if (!info) {
-		err = ENOMEM;
-		goto err_priv;
-	}
-
 	priv->local.family = -1;
 	if (info[IFLA_IPTUN_LOCAL]) {
 		if ((err = addr_init(&priv->local, family, -1, nla_read(info[IFLA_IPTUN_LOCAL]))))
-			goto err_attrs;
+			goto err_priv;
 		if (!addr_is_zero(&priv->local))
 			if_add_config(entry, "local", "%s", priv->local.formatted);
 	}
@@ -95,14 +115,14 @@ static int ipxipy_netlink(int family, struct if_entry *entry, struct nlattr **li
 	if (info[IFLA_IPTUN_REMOTE]) {
 		struct addr addr;
 		if ((err = addr_init(&addr, family, -1, nla_read(info[IFLA_IPTUN_REMOTE]))))
-			goto err_attrs;
+			goto err_priv;
 		if (!addr_is_zero(&addr))
 			if_add_config(entry, "remote", "%s", addr.formatted);
 		addr_destruct(&addr);
 	}
 
 	if (info[IFLA_IPTUN_LINK])
-		entry->link_index = nla_read_u8(info[IFLA_IPTUN_LINK]);
+		entry->link_index = nla_read_u32(info[IFLA_IPTUN_LINK]);
 
 	if (family == AF_INET6 && info[IFLA_IPTUN_PROTO]) {
 		switch (nla_read_u8(info[IFLA_IPTUN_PROTO])) {
@@ -118,29 +138,29 @@ static int ipxipy_netlink(int family, struct if_entry *entry, struct nlattr **li
 		}
 	}
 
-	free(info);
 	return 0;
 
-err_attrs:
-	free(info);
 err_priv:
 	free(priv);
 	return err;
 }
 
-static int ipip_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int ipip_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			struct nlattr **data)
 {
-	return ipxipy_netlink(AF_INET, entry, linkinfo);
+	return ipxipy_netlink(AF_INET, entry, data);
 }
 
-static int sit_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int sit_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+		       struct nlattr **data)
 {
-	return ipxipy_netlink(AF_INET, entry, linkinfo);
+	return ipxipy_netlink(AF_INET, entry, data);
 }
 
-static int ipxip6_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int ipxip6_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			  struct nlattr **data)
 {
-	return ipxipy_netlink(AF_INET6, entry, linkinfo);
+	return ipxipy_netlink(AF_INET6, entry, data);
 }
 
 static int ipxipy_post(struct if_entry *entry, _unused struct list *netns_list)
@@ -160,3 +180,10 @@ static int ipxipy_post(struct if_entry *entry, _unused struct list *netns_list)
 
 	return 0;
 }
+
+static struct addr *ipxipy_tunnel_local(struct if_entry *entry)
+{
+	struct ipxipy_priv *priv = entry->handler_private;
+
+	return priv->local.family >= 0 ? &priv->local : NULL;
+}
@@ -22,11 +22,20 @@
 #include "../handler.h"
 #include "../if.h"
 #include "../netlink.h"
+#include "../utils.h"
 
-static int macsec_netlink(struct if_entry *entry, struct nlattr **linkinfo);
+static int macsec_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			  struct nlattr **data);
+
+static const struct nla_policy macsec_policy[IFLA_MACSEC_MAX + 1] = {
+	[IFLA_MACSEC_SCI] = { .type = NLA_U64 },
+};
 
 static struct if_handler h_macsec = {
 	.driver = "macsec",
+	.sources = HANDLER_NETLINK,
+	.data_policy = macsec_policy,
+	.data_max = IFLA_MACSEC_MAX,
 	.netlink = macsec_netlink,
 };
 
@@ -35,31 +44,16 @@ void handler_macsec_register(void)
 	if_handler_register(&h_macsec);
 }
 
-static int macsec_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int macsec_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			  struct nlattr **macsecinfo)
 {
-	struct nlattr **macsecinfo;
-	int err = 0;
 	uint64_t sci;
 
-	if (!linkinfo || !linkinfo[IFLA_INFO_DATA])
+	if (!macsecinfo || !macsecinfo[IFLA_MACSEC_SCI])
 		return ENOENT;
 
-	macsecinfo = nla_nested_attrs(linkinfo[IFLA_INFO_DATA], IFLA_MACSEC_MAX);
-	if (!macsecinfo)
-		return ENOMEM;
-
-	if (!macsecinfo[IFLA_MACSEC_SCI]) {
-		err = ENOENT;
-		goto err_attrs;
-	}
-
 	sci = nla_read_be64(macsecinfo[IFLA_MACSEC_SCI]);
-	if (asprintf(&entry->edge_label, "sci %" PRIx64, sci) < 0) {
-		err = ENOMEM;
-		goto err_attrs;
-	}
-
-err_attrs:
-	free(macsecinfo);
-	return err;
+	if (asprintf(&entry->edge_label, "sci %" PRIx64, sci) < 0)
+		return ENOMEM;
+	return 0;
 }
@@ -563,7 +563,7 @@ err:
 
 static int check_vport(struct netns_entry *ns, struct if_entry *entry)
 {
-	struct nl_handle hnd;
+	struct nl_handle *hnd;
 	struct ovs_header oh = { .dp_ifindex = 0 };
 	struct nlmsg *req, *resp;
 	int err = ENOMEM;
@@ -574,18 +574,16 @@ static int check_vport(struct netns_entry *ns, struct if_entry *entry)
 	 */
 	if (!vport_genl_id)
 		return 0;
-	if (netns_switch(ns))
-		return 0;
-	if (genl_open(&hnd))
+	if (netns_nl_get(ns, NETLINK_GENERIC, &hnd))
 		return 0;
 
 	req = genlmsg_new(vport_genl_id, OVS_VPORT_CMD_GET, 0);
 	if (!req)
-		goto out_hnd;
+		return 0;
 	if (nlmsg_put(req, &oh, sizeof(oh)) ||
 	    nla_put_str(req, OVS_VPORT_ATTR_NAME, entry->if_name))
 		goto out_req;
-	err = nl_exchange(&hnd, req, &resp);
+	err = nl_exchange(hnd, req, &resp);
 	if (err)
 		goto out_req;
 	/* Keep err = 0. We're only interested whether the call succeeds or
@@ -594,8 +592,6 @@ static int check_vport(struct netns_entry *ns, struct if_entry *entry)
 	nlmsg_free(resp);
 out_req:
 	nlmsg_free(req);
-out_hnd:
-	nl_close(&hnd);
 	return !err;
 }
 
@@ -18,12 +18,14 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "../dump.h"
 #include "../handler.h"
 #include "../if.h"
 #include "../label.h"
 #include "../list.h"
 #include "../netlink.h"
 #include "../netns.h"
+#include "../prefetch.h"
 #include "../route.h"
 
 #include "../compat.h"
@@ -32,6 +34,7 @@ static int route_scan(struct netns_entry *entry);
 static void route_cleanup(struct netns_entry *entry);
 
 static struct netns_handler h_route = {
+	.sources = HANDLER_NETLINK,
 	.scan = route_scan,
 	.cleanup = route_cleanup,
 };
@@ -46,7 +49,7 @@ static int route_parse_metrics(struct list *metrics, struct nlattr *mxrta)
 	struct rtmetric *rtm;
 
 	for_each_nla_nested(a, mxrta) {
-		if (a->nla_type >= RTAX_CC_ALGO)
+		if (a->nla_type >= RTAX_CC_ALGO || nla_len(a) < sizeof(uint32_t))
 			continue;
 
 		rtm = calloc(1, sizeof(struct rtmetric));
@@ -61,10 +64,30 @@ static int route_parse_metrics(struct list *metrics, struct nlattr *mxrta)
 	return 0;
 }
 
+/* Indexed by rtm_family != AF_INET, as addr_init takes 16 bytes for every
+ * family but AF_INET. */
+#define ROUTE_POLICY(addr_len)						\
+	{								\
+		[RTA_DST] = { .type = NLA_BINARY, .len = addr_len },	\
+		[RTA_SRC] = { .type = NLA_BINARY, .len = addr_len },	\
+		[RTA_IIF] = { .type = NLA_U32 },			\
+		[RTA_OIF] = { .type = NLA_U32 },			\
+		[RTA_GATEWAY] = { .type = NLA_BINARY, .len = addr_len }, \
+		[RTA_PRIORITY] = { .type = NLA_U32 },			\
+		[RTA_PREFSRC] = { .type = NLA_BINARY, .len = addr_len }, \
+		[RTA_METRICS] = { .type = NLA_NESTED },			\
+		[RTA_TABLE] = { .type = NLA_U32 },			\
+	}
+
+static const struct nla_policy route_policy[2][RTA_MAX + 1] = {
+	ROUTE_POLICY(4),
+	ROUTE_POLICY(16),
+};
+
 int route_create_netlink(struct route **rte, struct nlmsg *msg)
 {
+	struct nlattr *tb[RTA_MAX + 1];
 	struct rtmsg *rtmsg;
-	struct nlattr **tb;
 	struct route *r;
 	int err;
 
@@ -87,11 +110,7 @@ int route_create_netlink(struct route **rte, struct nlmsg *msg)
 	r->tos = rtmsg->rtm_tos;
 	r->type = rtmsg->rtm_type;
 
-	tb = nlmsg_attrs(msg, RTA_MAX);
-	if (!tb) {
-		err = ENOMEM;
-		goto err_rte;
-	}
+	nlmsg_parse(msg, tb, RTA_MAX, route_policy[r->family != AF_INET]);
 
 	if (tb[RTA_TABLE])
 		r->table_id = nla_read_u32(tb[RTA_TABLE]);
@@ -122,20 +141,17 @@ int route_create_netlink(struct route **rte, struct nlmsg *msg)
 	list_init(&r->metrics);
 	if (tb[RTA_METRICS])
 		if ((err = route_parse_metrics(&r->metrics, tb[RTA_METRICS])))
-			goto err_tb;
+			goto err_rte;
 
 	*rte = r;
-	free(tb);
 	return 0;
 
-err_tb:
-	free(tb);
 err_rte:
 	free(r);
 	return err;
 }
 
-static int rtable_create(struct rtable **rtd, int id)
+static int rtable_create(struct rtable **rtd, unsigned int id)
 {
 	struct rtable *rt;
 
@@ -161,77 +177,152 @@ static struct if_entry *find_if_by_ifindex(struct list *list, unsigned int ifind
 }
 
 
-int route_scan(struct netns_entry *ns)
+static void route_destruct(struct route *r)
 {
-	struct nl_handle hnd;
-	struct nlmsg *req, *resp;
-	struct rtmsg msg = {
-		.rtm_table = RT_TABLE_UNSPEC,
-		.rtm_protocol = RTPROT_UNSPEC,
-	};
-	struct rtable *tables [256];
-	struct route *r = NULL;
-	int err, i;
-
-	memset(tables, 0, sizeof(tables));
-	list_init(&ns->rtables);
+	list_free(&r->metrics, NULL);
+}
 
-	if ((err = rtnl_open(&hnd)))
-		return err;
+static void rtable_free(struct rtable *rt)
+{
+	list_free(&rt->routes, (destruct_f) route_destruct);
+}
 
-	req = nlmsg_new(RTM_GETROUTE, NLM_F_DUMP);
-	if (!req) {
-		err = ENOMEM;
-		goto err_handle;
-	}
-	err = nlmsg_put(req, &msg, sizeof(msg));
-	if (err)
-		goto err_req;
+struct route_scan_ctx {
+	struct netns_entry *ns;
+	/* table of the current dump, RT_TABLE_UNSPEC for all */
+	unsigned int table;
+};
 
-	err = nl_exchange(&hnd, req, &resp);
-	if (err)
-		goto err_req;
+static void route_discard(struct rtable *rt)
+{
+	node_remove(node(rt));
+	rtable_free(rt);
+	free(rt);
+}
 
-	for_each_nlmsg(nle, resp) {
-		if ((err = route_create_netlink(&r, nle)))
-			goto err_resp;
+/* ns->rtables is kept sorted by id in descending order. Returns the
+ * table, or the one it is to be inserted before (NULL for the tail). */
+static struct rtable *rtable_find(struct netns_entry *ns, unsigned int id)
+{
+	struct rtable *rt;
 
-		r->oif = find_if_by_ifindex(&ns->ifaces, r->oifindex);
-		r->iif = find_if_by_ifindex(&ns->ifaces, r->iifindex);
+	list_for_each(rt, ns->rtables)
+		if (rt->id <= id)
+			return rt;
+	return NULL;
+}
 
-		if (!tables[r->table_id])
-			if ((err = rtable_create(&tables[r->table_id], r->table_id)))
-				goto err_route;
+static int route_add(struct nlmsg *nle, void *arg)
+{
+	struct route_scan_ctx *ctx = arg;
+	struct rtable *rt, *next;
+	struct nlmsghdr *hdr;
+	struct rtmsg *rtmsg;
+	struct route *r;
+	int err;
 
-		list_append(&tables[r->table_id]->routes, node(r));
-		r = NULL;
+	if (!nle) {
+		/* the route dump is restarted */
+		for (rt = list_head(ctx->ns->rtables); node_valid(rt); rt = next) {
+			next = node_next(rt);
+			if (!ctx->table || rt->id == ctx->table)
+				route_discard(rt);
+		}
+		return 0;
 	}
 
-	for (i = 255; i >= 0; i--) {
-		if (tables[i])
-			list_append(&ns->rtables, node(tables[i]));
+	/* Kernels without NETLINK_GET_STRICT_CHK do not filter. */
+	hdr = nlmsg_get_hdr(nle);
+	if (hdr->nlmsg_type == RTM_NEWROUTE && hdr->nlmsg_len >= NLMSG_LENGTH(sizeof(*rtmsg))) {
+		rtmsg = NLMSG_DATA(hdr);
+		if (rtmsg->rtm_flags & RTM_F_CLONED)
+			return 0;
 	}
-
-err_route:
-	if (r)
+	if ((err = route_create_netlink(&r, nle)))
+		return err;
+	if (ctx->table && r->table_id != ctx->table) {
+		route_destruct(r);
 		free(r);
-err_resp:
-	nlmsg_free(resp);
-err_req:
+		return 0;
+	}
+
+	r->oif = find_if_by_ifindex(&ctx->ns->ifaces, r->oifindex);
+	r->iif = find_if_by_ifindex(&ctx->ns->ifaces, r->iifindex);
+
+	next = rtable_find(ctx->ns, r->table_id);
+	if (next && next->id == r->table_id) {
+		rt = next;
+	} else {
+		if ((err = rtable_create(&rt, r->table_id))) {
+			route_destruct(r);
+			free(r);
+			return err;
+		}
+		if (next)
+			list_insert_before(node(next), node(rt));
+		else
+			list_append(&ctx->ns->rtables, node(rt));
+	}
+
+	list_append(&rt->routes, node(r));
+	return 0;
+}
+
+/* The routes are parsed as they arrive. */
+static int route_dump(struct route_scan_ctx *ctx)
+{
+	struct nl_handle *hnd;
+	struct nlmsg *req;
+	int err;
+
+	if ((err = netns_nl_get(ctx->ns, NETLINK_ROUTE, &hnd)))
+		return err;
+
+	req = dump_route_req(ctx->table);
+	if (!req)
+		return ENOMEM;
+	err = nl_dump(hnd, req, route_add, ctx);
 	nlmsg_free(req);
-err_handle:
-	nl_close(&hnd);
 	return err;
 }
 
-static void route_destruct(struct route *r)
+/* A filtered IPv4 dump fails if the table does not exist. */
+static int route_dump_done(struct route_scan_ctx *ctx, int err)
 {
-	list_free(&r->metrics, NULL);
+	struct rtable *rt;
+
+	if (err == ENOENT && ctx->table) {
+		rt = rtable_find(ctx->ns, ctx->table);
+		if (rt && rt->id == ctx->table)
+			route_discard(rt);
+		return 0;
+	}
+	return err;
 }
 
-static void rtable_free(struct rtable *rt)
+int route_scan(struct netns_entry *ns)
 {
-	list_free(&rt->routes, (destruct_f) route_destruct);
+	struct route_scan_ctx ctx = { .ns = ns };
+	const unsigned int *selected;
+	unsigned int count, t;
+	int err = 0;
+
+	list_init(&ns->rtables);
+
+	/* The first selected table is prefetched, the others are dumped
+	 * one by one. */
+	count = dump_route_tables(&selected);
+	if (count)
+		ctx.table = selected[0];
+	if ((err = prefetch_dump(ns, PREFETCH_ROUTE, route_add, &ctx)) < 0)
+		err = route_dump(&ctx);
+	err = route_dump_done(&ctx, err);
+	for (t = 1; !err && t < count; t++) {
+		ctx.table = selected[t];
+		err = route_dump_done(&ctx, route_dump(&ctx));
+	}
+	/* On error, the tables are freed by route_cleanup. */
+	return err;
 }
 
 static void route_cleanup(struct netns_entry *entry)
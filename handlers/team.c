@@ -52,6 +52,7 @@ static void team_cleanup(struct if_entry *entry);
 
 static struct if_handler h_team = {
 	.driver = "team",
+	.sources = HANDLER_DAEMON,
 	.private_size = sizeof(struct team_priv),
 	.scan = team_scan,
 	.post = team_post,
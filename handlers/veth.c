@@ -29,6 +29,7 @@ static int veth_post(struct if_entry *entry, struct list *netns_list);
 
 static struct if_handler h_veth = {
 	.driver = "veth",
+	.sources = HANDLER_ETHTOOL,
 	.scan = veth_scan,
 	.post = veth_post,
 };
@@ -21,16 +21,25 @@
 #include "../handler.h"
 #include "../if.h"
 #include "../netlink.h"
+#include "../utils.h"
 
 struct vlan_private {
 	unsigned int tag;
 };
 
-static int vlan_netlink(struct if_entry *entry, struct nlattr **linkinfo);
+static int vlan_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			struct nlattr **data);
+
+static const struct nla_policy vlan_policy[IFLA_VLAN_MAX + 1] = {
+	[IFLA_VLAN_ID] = { .type = NLA_U16 },
+};
 
 static struct if_handler h_vlan = {
 	.driver = "802.1Q VLAN Support",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct vlan_private),
+	.data_policy = vlan_policy,
+	.data_max = IFLA_VLAN_MAX,
 	.netlink = vlan_netlink,
 };
 
@@ -39,27 +48,15 @@ void handler_vlan_register(void)
 	if_handler_register(&h_vlan);
 }
 
-static int vlan_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int vlan_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			struct nlattr **vlanattr)
 {
 	struct vlan_private *priv = entry->handler_private;
-	struct nlattr **vlanattr;
-	int err = 0;
 
-	if (!linkinfo || !linkinfo[IFLA_INFO_DATA])
+	if (!vlanattr || !vlanattr[IFLA_VLAN_ID])
 		return ENOENT;
-	vlanattr = nla_nested_attrs(linkinfo[IFLA_INFO_DATA], IFLA_VLAN_MAX);
-	if (!vlanattr)
-		return ENOMEM;
-	if (!vlanattr[IFLA_VLAN_ID]) {
-		err = ENOENT;
-		goto out;
-	}
 	priv->tag = nla_read_u16(vlanattr[IFLA_VLAN_ID]);
-	if (asprintf(&entry->edge_label, "tag %d", priv->tag) < 0) {
-		err = ENOMEM;
-		goto out;
-	}
-out:
-	free(vlanattr);
-	return err;
+	if (asprintf(&entry->edge_label, "tag %d", priv->tag) < 0)
+		return ENOMEM;
+	return 0;
 }
@@ -32,24 +32,46 @@
 #include <linux/ip.h>
 #include <linux/if_tunnel.h>
 
-static int vti4_netlink(struct if_entry *entry, struct nlattr **linkinfo);
-static int vti6_netlink(struct if_entry *entry, struct nlattr **linkinfo);
+static int vti4_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			struct nlattr **data);
+static int vti6_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			struct nlattr **data);
 static int vti_post(struct if_entry *entry, struct list *netns_list);
+static struct addr *vti_tunnel_local(struct if_entry *entry);
 
 struct vti_priv {
 	struct addr local;
 };
 
+#define VTI_POLICY(addr_len)						\
+	{								\
+		[IFLA_VTI_IKEY] = { .type = NLA_U32 },			\
+		[IFLA_VTI_OKEY] = { .type = NLA_U32 },			\
+		[IFLA_VTI_LOCAL] = { .type = NLA_BINARY, .len = addr_len }, \
+		[IFLA_VTI_REMOTE] = { .type = NLA_BINARY, .len = addr_len }, \
+	}
+
+static const struct nla_policy vti4_policy[IFLA_VTI_MAX + 1] = VTI_POLICY(4);
+static const struct nla_policy vti6_policy[IFLA_VTI_MAX + 1] = VTI_POLICY(16);
+
 static struct if_handler h_vti4 = {
 	.driver = "vti",
+	.sources = HANDLER_NETLINK,
+	.data_policy = vti4_policy,
+	.data_max = IFLA_VTI_MAX,
 	.netlink = vti4_netlink,
 	.post = vti_post,
+	.tunnel_local = vti_tunnel_local,
 };
 
 static struct if_handler h_vti6 = {
 	.driver = "vti6",
+	.sources = HANDLER_NETLINK,
+	.data_policy = vti6_policy,
+	.data_max = IFLA_VTI_MAX,
 	.netlink = vti6_netlink,
 	.post = vti_post,
+	.tunnel_local = vti_tunnel_local,
 };
 
 void handler_vti_register(void)
@@ -58,13 +80,12 @@ void handler_vti_register(void)
 	if_handler_register(&h_vti6);
 }
 
-static int vti_netlink(int family, struct if_entry *entry, struct nlattr **linkinfo)
+static int vti_netlink(int family, struct if_entry *entry, struct nlattr **vtiinfo)
 {
-	struct nlattr **vtiinfo;
 	struct vti_priv *priv;
 	int err, key;
 
-	if (!linkinfo || !linkinfo[IFLA_INFO_DATA])
+	if (!vtiinfo)
 		return ENOENT;
 
 	priv = calloc(1, sizeof(struct vti_priv));
@@ -72,16 +93,10 @@ static int vti_netlink(int family, struct if_entry *entry, struct nlattr **linki
 		return ENOMEM;
 	entry->handler_private = priv;
 
-	vtiinfo = nla_nested_attrs(linkinfo[IFLA_INFO_DATA], IFLA_VTI_MAX);
-	if (!vtiinfo) {
-		err = ENOMEM;
-		goto err_priv;
-	}
-
 	if (vtiinfo[IFLA_VTI_REMOTE]) {
 		struct addr addr;
 		if ((err = addr_init(&addr, family, -1, nla_read(vtiinfo[IFLA_VTI_REMOTE]))))
-			goto err_attrs;
+			goto err_priv;
 		if (!addr_is_zero(&addr))
 			if_add_config(entry, "remote", "%s", addr.formatted);
 		addr_destruct(&addr);
@@ -90,7 +105,7 @@ static int vti_netlink(int family, struct if_entry *entry, struct nlattr **linki
 	priv->local.family = -1;
 	if (vtiinfo[IFLA_VTI_LOCAL]) {
 		if ((err = addr_init(&priv->local, family, -1, nla_read(vtiinfo[IFLA_VTI_LOCAL]))))
-			goto err_attrs;
+			goto err_priv;
 		if (!addr_is_zero(&priv->local))
 			if_add_config(entry, "local", "%s", priv->local.formatted);
 	}
@@ -105,24 +120,23 @@ static int vti_netlink(int family, struct if_entry *entry, struct nlattr **linki
 			if_add_config(entry, "okey", "%u", key);
 	}
 
-	free(vtiinfo);
 	return 0;
 
-err_attrs:
-	free(vtiinfo);
 err_priv:
 	free(priv);
 	return err;
 }
 
-static int vti4_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int vti4_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			struct nlattr **data)
 {
-	return vti_netlink(AF_INET, entry, linkinfo);
+	return vti_netlink(AF_INET, entry, data);
 }
 
-static int vti6_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int vti6_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			struct nlattr **data)
 {
-	return vti_netlink(AF_INET6, entry, linkinfo);
+	return vti_netlink(AF_INET6, entry, data);
 }
 
 static int vti_post(struct if_entry *entry, _unused struct list *netns_list)
@@ -142,3 +156,10 @@ static int vti_post(struct if_entry *entry, _unused struct list *netns_list)
 
 	return 0;
 }
+
+static struct addr *vti_tunnel_local(struct if_entry *entry)
+{
+	struct vti_priv *priv = entry->handler_private;
+
+	return priv && priv->local.family >= 0 ? &priv->local : NULL;
+}
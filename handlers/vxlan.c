@@ -36,14 +36,30 @@ struct vxlan_priv {
 	int flags;
 };
 
-static int vxlan_netlink(struct if_entry *entry, struct nlattr **linkinfo);
+static int vxlan_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			 struct nlattr **data);
 static int vxlan_post(struct if_entry *entry, struct list *netns_list);
+static struct addr *vxlan_tunnel_local(struct if_entry *entry);
+
+static const struct nla_policy vxlan_policy[IFLA_VXLAN_MAX + 1] = {
+	[IFLA_VXLAN_ID] = { .type = NLA_U32 },
+	[IFLA_VXLAN_GROUP] = { .type = NLA_BINARY, .len = 4 },
+	[IFLA_VXLAN_LOCAL] = { .type = NLA_BINARY, .len = 4 },
+	[IFLA_VXLAN_PORT] = { .type = NLA_U16 },
+	[IFLA_VXLAN_GROUP6] = { .type = NLA_BINARY, .len = 16 },
+	[IFLA_VXLAN_LOCAL6] = { .type = NLA_BINARY, .len = 16 },
+	[IFLA_VXLAN_COLLECT_METADATA] = { .type = NLA_U8 },
+};
 
 static struct if_handler h_vxlan = {
 	.driver = "vxlan",
+	.sources = HANDLER_NETLINK,
 	.private_size = sizeof(struct vxlan_priv),
+	.data_policy = vxlan_policy,
+	.data_max = IFLA_VXLAN_MAX,
 	.netlink = vxlan_netlink,
 	.post = vxlan_post,
+	.tunnel_local = vxlan_tunnel_local,
 };
 
 #define VXLAN_COLLECT_METADATA 1
@@ -73,9 +89,9 @@ static int vxlan_fill_addr(struct addr **addr, int ai_family, struct nlattr *att
 	return 0;
 }
 
-static int vxlan_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int vxlan_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			 struct nlattr **vxlaninfo)
 {
-	struct nlattr **vxlaninfo;
 	uint16_t port;
 	struct vxlan_priv *priv;
 	int err;
@@ -87,13 +103,8 @@ static int vxlan_netlink(struct if_entry *entry, struct nlattr **linkinfo)
 	}
 	entry->handler_private = priv;
 
-	if (!linkinfo || !linkinfo[IFLA_INFO_DATA]) {
-		err = ENOENT;
-		goto err_priv;
-	}
-	vxlaninfo = nla_nested_attrs(linkinfo[IFLA_INFO_DATA], IFLA_VXLAN_MAX);
 	if (!vxlaninfo) {
-		err = ENOMEM;
+		err = ENOENT;
 		goto err_priv;
 	}
 
@@ -115,20 +126,17 @@ static int vxlan_netlink(struct if_entry *entry, struct nlattr **linkinfo)
 	} else {
 		/* These can be set in COLLECT_METADATA, but are ignored by kernel */
 		if ((err = vxlan_fill_addr(&priv->group, AF_INET, vxlaninfo[IFLA_VXLAN_GROUP])))
-			goto err_attrs;
+			goto err_priv;
 		if ((err = vxlan_fill_addr(&priv->group, AF_INET6, vxlaninfo[IFLA_VXLAN_GROUP6])))
-			goto err_attrs;
+			goto err_priv;
 		if ((err = vxlan_fill_addr(&priv->local, AF_INET, vxlaninfo[IFLA_VXLAN_LOCAL])))
-			goto err_attrs;
+			goto err_priv;
 		if ((err = vxlan_fill_addr(&priv->local, AF_INET6, vxlaninfo[IFLA_VXLAN_LOCAL6])))
-			goto err_attrs;
+			goto err_priv;
 	}
 
-	free(vxlaninfo);
 	return 0;
 
-err_attrs:
-	free(vxlaninfo);
 err_priv:
 	free(priv);
 err:
@@ -154,3 +162,10 @@ static int vxlan_post(struct if_entry *entry, _unused struct list *netns_list)
 		if_add_config(entry, "to", "%s", priv->group->formatted);
 	return 0;
 }
+
+static struct addr *vxlan_tunnel_local(struct if_entry *entry)
+{
+	struct vxlan_priv *priv = entry->handler_private;
+
+	return priv->local;
+}
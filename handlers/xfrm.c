@@ -28,10 +28,18 @@
 
 #include "../compat.h"
 
-static int xfrm_netlink(struct if_entry *entry, struct nlattr **linkinfo);
+static int xfrm_netlink(struct if_entry *entry, struct nlattr **linkinfo,
+			struct nlattr **data);
+
+static const struct nla_policy xfrm_policy[IFLA_XFRM_MAX + 1] = {
+	[IFLA_XFRM_IF_ID] = { .type = NLA_U32 },
+};
 
 static struct if_handler h_xfrm = {
 	.driver = "xfrm",
+	.sources = HANDLER_NETLINK,
+	.data_policy = xfrm_policy,
+	.data_max = IFLA_XFRM_MAX,
 	.netlink = xfrm_netlink,
 };
 
@@ -40,23 +48,18 @@ void handler_xfrm_register(void)
 	if_handler_register(&h_xfrm);
 }
 
-static int xfrm_netlink(struct if_entry *entry, struct nlattr **linkinfo)
+static int xfrm_netlink(struct if_entry *entry, _unused struct nlattr **linkinfo,
+			struct nlattr **xfrminfo)
 {
-	struct nlattr **xfrminfo;
 	int if_id;
 
-	if (!linkinfo || !linkinfo[IFLA_INFO_DATA])
-		return ENOENT;
-
-	xfrminfo = nla_nested_attrs(linkinfo[IFLA_INFO_DATA], IFLA_XFRM_MAX);
 	if (!xfrminfo)
-		return ENOMEM;
+		return ENOENT;
 
 	if (xfrminfo[IFLA_XFRM_IF_ID]) {
 		if_id = nla_read_u32(xfrminfo[IFLA_XFRM_IF_ID]);
 		if_add_config(entry, "if_id", "0x%x", if_id);
 	}
 
-	free(xfrminfo);
 	return 0;
 }
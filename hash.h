@@ -0,0 +1,168 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _HASH_H
+#define _HASH_H
+
+#include <errno.h>
+#include <stdlib.h>
+#include "list.h"
+
+/*
+ * Simple chained hash table keyed by an integer. Like with lists, insert
+ * 'struct hnode' as a member of a structure to put it into a hash table.
+ * The table does not own the objects, only the bucket array.
+ */
+struct hnode {
+	struct hnode *next;
+	unsigned long key;
+};
+
+struct hash {
+	struct hnode **buckets;
+	unsigned int bits;
+	unsigned int count;
+};
+
+#define HASH_INITIALIZER	{ .buckets = NULL, .bits = 0, .count = 0 }
+#define HASH_MIN_BITS		6
+
+#define hash_entry(ptr, type, member) \
+	((ptr) ? NODE_CONTAINER(ptr, type, member) : NULL)
+
+static inline unsigned int hash_bucket(unsigned long key, unsigned int bits)
+{
+	/* multiplicative hashing, 2^64 / golden ratio */
+	return (unsigned int)((key * 0x9e3779b97f4a7c15ULL) >> (64 - bits));
+}
+
+static inline int hash_init(struct hash *h, unsigned int bits)
+{
+	if (bits < HASH_MIN_BITS)
+		bits = HASH_MIN_BITS;
+	h->buckets = calloc(1UL << bits, sizeof(struct hnode *));
+	if (!h->buckets)
+		return ENOMEM;
+	h->bits = bits;
+	h->count = 0;
+	return 0;
+}
+
+static inline void hash_free(struct hash *h)
+{
+	free(h->buckets);
+	h->buckets = NULL;
+	h->bits = 0;
+	h->count = 0;
+}
+
+static inline void __hash_insert(struct hash *h, struct hnode *n)
+{
+	struct hnode **b = &h->buckets[hash_bucket(n->key, h->bits)];
+
+	n->next = *b;
+	*b = n;
+}
+
+/*
+ * Grows the table when the load factor exceeds 2. Failure to grow is not
+ * fatal, the chains just get longer.
+ */
+static inline void __hash_grow(struct hash *h)
+{
+	struct hash new;
+	struct hnode *n, *next;
+	unsigned int i;
+
+	if (hash_init(&new, h->bits + 1))
+		return;
+	for (i = 0; i < (1U << h->bits); i++) {
+		for (n = h->buckets[i]; n; n = next) {
+			next = n->next;
+			__hash_insert(&new, n);
+		}
+	}
+	new.count = h->count;
+	free(h->buckets);
+	*h = new;
+}
+
+static inline int hash_add(struct hash *h, struct hnode *n, unsigned long key)
+{
+	int err;
+
+	if (!h->buckets && (err = hash_init(h, HASH_MIN_BITS)))
+		return err;
+	n->key = key;
+	__hash_insert(h, n);
+	if (++h->count > (2U << h->bits))
+		__hash_grow(h);
+	return 0;
+}
+
+/*
+ * Returns the first node with the given key or NULL.
+ */
+static inline struct hnode *hash_find(struct hash *h, unsigned long key)
+{
+	struct hnode *n;
+
+	if (!h->buckets)
+		return NULL;
+	for (n = h->buckets[hash_bucket(key, h->bits)]; n; n = n->next)
+		if (n->key == key)
+			return n;
+	return NULL;
+}
+
+static inline void hash_remove(struct hash *h, struct hnode *n)
+{
+	struct hnode **p;
+
+	if (!h->buckets)
+		return;
+	for (p = &h->buckets[hash_bucket(n->key, h->bits)]; *p; p = &(*p)->next) {
+		if (*p == n) {
+			*p = n->next;
+			n->next = NULL;
+			h->count--;
+			return;
+		}
+	}
+}
+
+/*
+ * Frees all the objects in the table and the table itself. Like
+ * list_free, this requires 'struct hnode' to be the first member.
+ */
+static inline void hash_free_all(struct hash *h, destruct_f destruct)
+{
+	struct hnode *n, *next;
+	unsigned int i;
+
+	if (!h->buckets)
+		return;
+	for (i = 0; i < (1U << h->bits); i++) {
+		for (n = h->buckets[i]; n; n = next) {
+			next = n->next;
+			if (destruct)
+				destruct(n);
+			free(n);
+		}
+	}
+	hash_free(h);
+}
+
+#endif
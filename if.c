@@ -23,16 +23,59 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include "dump.h"
 #include "ethtool.h"
 #include "handler.h"
 #include "label.h"
 #include "list.h"
 #include "netlink.h"
 #include "netns.h"
+#include "prefetch.h"
 #include "utils.h"
 
 #include "compat.h"
 
+static const struct nla_policy ifla_policy[IFLA_MAX + 1] = {
+	[IFLA_ADDRESS] = { .type = NLA_BINARY },
+	[IFLA_IFNAME] = { .type = NLA_STRING },
+	[IFLA_MTU] = { .type = NLA_U32 },
+	[IFLA_LINK] = { .type = NLA_U32 },
+	[IFLA_MASTER] = { .type = NLA_U32 },
+	[IFLA_LINKINFO] = { .type = NLA_NESTED },
+	[IFLA_LINK_NETNSID] = { .type = NLA_U32 },
+	[IFLA_PHYS_PORT_NAME] = { .type = NLA_STRING },
+	[IFLA_XDP] = { .type = NLA_NESTED },
+	[IFLA_PARENT_DEV_NAME] = { .type = NLA_STRING },
+	[IFLA_PARENT_DEV_BUS_NAME] = { .type = NLA_STRING },
+};
+
+static const struct nla_policy ifla_info_policy[IFLA_INFO_MAX + 1] = {
+	[IFLA_INFO_KIND] = { .type = NLA_STRING },
+	[IFLA_INFO_DATA] = { .type = NLA_NESTED },
+	[IFLA_INFO_SLAVE_KIND] = { .type = NLA_STRING },
+	[IFLA_INFO_SLAVE_DATA] = { .type = NLA_NESTED },
+};
+
+static const struct nla_policy ifla_xdp_policy[IFLA_XDP_MAX + 1] = {
+	[IFLA_XDP_ATTACHED] = { .type = NLA_U8 },
+	[IFLA_XDP_PROG_ID] = { .type = NLA_U32 },
+	[IFLA_XDP_DRV_PROG_ID] = { .type = NLA_U32 },
+	[IFLA_XDP_SKB_PROG_ID] = { .type = NLA_U32 },
+	[IFLA_XDP_HW_PROG_ID] = { .type = NLA_U32 },
+};
+
+/* Indexed by ifa_family == AF_INET6. */
+static const struct nla_policy ifa_policy[2][IFA_MAX + 1] = {
+	{
+		[IFA_ADDRESS] = { .type = NLA_BINARY, .len = 4 },
+		[IFA_LOCAL] = { .type = NLA_BINARY, .len = 4 },
+	},
+	{
+		[IFA_ADDRESS] = { .type = NLA_BINARY, .len = 16 },
+		[IFA_LOCAL] = { .type = NLA_BINARY, .len = 16 },
+	},
+};
+
 static const char *xdp_mode_name[] = {
 	"",
 	"driver",
@@ -65,38 +108,57 @@ static int fill_if_xdp_prog(struct list *xdp_list, unsigned int mode,
 
 static int fill_if_xdp(struct list *xdp_list, struct nlattr *xdp_nla)
 {
-	struct nlattr **tb;
+	struct nlattr *tb[IFLA_XDP_MAX + 1];
 	unsigned int mode = XDP_ATTACHED_NONE;
-	int err = 0;
+	int err;
 
 	if (!xdp_nla)
 		/* XDP not supported */
 		return 0;
-	tb = nla_nested_attrs(xdp_nla, IFLA_XDP_MAX);
-	if (!tb)
-		return ENOMEM;
+	nla_parse_nested(tb, IFLA_XDP_MAX, ifla_xdp_policy, xdp_nla);
 	if (tb[IFLA_XDP_ATTACHED])
 		mode = nla_read_u8(tb[IFLA_XDP_ATTACHED]);
 	if (mode == XDP_ATTACHED_NONE)
-		goto out;
+		return 0;
 	if (mode == XDP_ATTACHED_MULTI) {
 		if ((err = fill_if_xdp_prog(xdp_list, XDP_ATTACHED_DRV, tb[IFLA_XDP_DRV_PROG_ID])) ||
 		    (err = fill_if_xdp_prog(xdp_list, XDP_ATTACHED_SKB, tb[IFLA_XDP_SKB_PROG_ID])) ||
 		    (err = fill_if_xdp_prog(xdp_list, XDP_ATTACHED_HW, tb[IFLA_XDP_HW_PROG_ID])))
-			goto out;
-	} else {
-		if ((err = fill_if_xdp_prog(xdp_list, mode, tb[IFLA_XDP_PROG_ID])))
-			goto out;
+			return err;
+		return 0;
 	}
-out:
-	free(tb);
-	return err;
+	return fill_if_xdp_prog(xdp_list, mode, tb[IFLA_XDP_PROG_ID]);
+}
+
+/* The parent device tells whether the interface is a PCI function.
+ * Interfaces created by rtnetlink are virtual and have no parent. */
+static int fill_if_parent(struct if_entry *dest, struct nlattr **tb,
+			  struct nlattr **linkinfo)
+{
+	if (tb[IFLA_PHYS_PORT_NAME]) {
+		dest->phys_port_name = strdup(nla_read_str(tb[IFLA_PHYS_PORT_NAME]));
+		if (!dest->phys_port_name)
+			return ENOMEM;
+	}
+
+	if (tb[IFLA_PARENT_DEV_NAME] && tb[IFLA_PARENT_DEV_BUS_NAME]) {
+		dest->pci_known = 1;
+		if (strcmp(nla_read_str(tb[IFLA_PARENT_DEV_BUS_NAME]), "pci"))
+			return 0;
+		dest->pci_path = strdup(nla_read_str(tb[IFLA_PARENT_DEV_NAME]));
+		if (!dest->pci_path)
+			return ENOMEM;
+	} else if (linkinfo[IFLA_INFO_KIND] ||
+		   (dest->flags & IF_LOOPBACK)) {
+		dest->pci_known = 1;
+	}
+	return 0;
 }
 
 static int fill_if_link(struct if_entry *dest, struct nlmsg *msg)
 {
+	struct nlattr *tb[IFLA_MAX + 1], *linkinfo[IFLA_INFO_MAX + 1];
 	struct ifinfomsg *ifi;
-	struct nlattr **tb, **linkinfo = NULL;
 	int err;
 
 	if (nlmsg_get_hdr(msg)->nlmsg_type != RTM_NEWLINK)
@@ -104,13 +166,9 @@ static int fill_if_link(struct if_entry *dest, struct nlmsg *msg)
 	ifi = nlmsg_get(msg, sizeof(*ifi));
 	if (!ifi)
 		return ENOENT;
-	tb = nlmsg_attrs(msg, IFLA_MAX);
-	if (!tb)
-		return ENOMEM;
-	if (!tb[IFLA_IFNAME]) {
-		err = ENOENT;
-		goto out;
-	}
+	nlmsg_parse(msg, tb, IFLA_MAX, ifla_policy);
+	if (!tb[IFLA_IFNAME])
+		return ENOENT;
 	dest->if_index = ifi->ifi_index;
 	dest->if_name = strdup(nla_read_str(tb[IFLA_IFNAME]));
 	if (!dest->if_name) {
@@ -130,13 +188,10 @@ static int fill_if_link(struct if_entry *dest, struct nlmsg *msg)
 		dest->link_netnsid = nla_read_s32(tb[IFLA_LINK_NETNSID]);
 	if (tb[IFLA_MTU])
 		dest->mtu = nla_read_u32(tb[IFLA_MTU]);
-	if (tb[IFLA_LINKINFO]) {
-		linkinfo = nla_nested_attrs(tb[IFLA_LINKINFO], IFLA_INFO_MAX);
-		if (!linkinfo) {
-			err = ENOMEM;
-			goto err_ifname;
-		}
-	}
+	if (tb[IFLA_LINKINFO])
+		nla_parse_nested(linkinfo, IFLA_INFO_MAX, ifla_info_policy, tb[IFLA_LINKINFO]);
+	else
+		memset(linkinfo, 0, sizeof(linkinfo));
 
 	if (tb[IFLA_ADDRESS]) {
 		err = mac_addr_fill_netlink(&dest->mac_addr, tb[IFLA_ADDRESS]);
@@ -151,8 +206,8 @@ static int fill_if_link(struct if_entry *dest, struct nlmsg *msg)
 		dest->driver = ethtool_driver(dest->if_name);
 	if (!dest->driver) {
 		/* No ethtool ops available, try IFLA_INFO_KIND */
-		if (tb[IFLA_LINKINFO] && linkinfo && linkinfo[IFLA_INFO_KIND])
-			dest->driver = strdup(RTA_DATA(linkinfo[IFLA_INFO_KIND]));
+		if (linkinfo[IFLA_INFO_KIND])
+			dest->driver = strdup(nla_read_str(linkinfo[IFLA_INFO_KIND]));
 	}
 	if (!dest->driver) {
 		/* Allow the program to continue at least with generic stuff
@@ -161,6 +216,9 @@ static int fill_if_link(struct if_entry *dest, struct nlmsg *msg)
 		dest->driver = strdup("unknown driver, please report a bug");
 	}
 
+	if ((err = fill_if_parent(dest, tb, linkinfo)))
+		goto err_driver;
+
 	if ((err = fill_if_xdp(&dest->xdp, tb[IFLA_XDP])))
 		goto err_driver;
 
@@ -171,8 +229,7 @@ static int fill_if_link(struct if_entry *dest, struct nlmsg *msg)
 		if (err != ENOENT)
 			goto err_driver;
 
-	err = 0;
-	goto out;
+	return 0;
 
 err_driver:
 	free(dest->driver);
@@ -180,21 +237,17 @@ err_driver:
 err_ifname:
 	free(dest->if_name);
 	dest->if_name = NULL;
-out:
-	free(tb);
-	free(linkinfo);
 	return err;
 }
 
 static int fill_if_addr(struct if_entry *dest, struct nlmsg *alist)
 {
+	struct nlattr *rta_tb[IFA_MAX + 1];
 	struct if_addr *entry;
 	struct ifaddrmsg *ifa;
-	struct nlattr **rta_tb;
 	int err;
 
 	for_each_nlmsg(ainfo, alist) {
-		rta_tb = NULL;
 		err = 0;
 		ifa = nlmsg_get(ainfo, sizeof(*ifa));
 		if (!ifa)
@@ -207,11 +260,8 @@ static int fill_if_addr(struct if_entry *dest, struct nlmsg *alist)
 		    ifa->ifa_family != AF_INET6)
 			/* only IP addresses supported (at least for now) */
 			goto skip;
-		rta_tb = nlmsg_attrs(ainfo, IFA_MAX);
-		if (!rta_tb) {
-			err = ENOMEM;
-			goto skip;
-		}
+		nlmsg_parse(ainfo, rta_tb, IFA_MAX,
+			    ifa_policy[ifa->ifa_family == AF_INET6]);
 		if (!rta_tb[IFA_LOCAL] && !rta_tb[IFA_ADDRESS])
 			/* don't care about broadcast and anycast adresses */
 			goto skip;
@@ -238,8 +288,6 @@ static int fill_if_addr(struct if_entry *dest, struct nlmsg *alist)
 		}
 skip:
 		nlmsg_unget(ainfo, sizeof(*ifa));
-		if (rta_tb)
-			free(rta_tb);
 		if (err)
 			return err;
 	}
@@ -265,47 +313,104 @@ struct if_entry *if_create(void)
 	return entry;
 }
 
+/* Creates a placeholder for an interface in a name space that was not
+ * scanned. Index 1 is always the loopback. */
+struct if_entry *if_create_stub(struct netns_entry *ns, unsigned int ifindex)
+{
+	struct if_entry *entry;
+	char buf[32];
+
+	entry = if_create();
+	if (!entry)
+		return NULL;
+	if (ifindex == 1)
+		snprintf(buf, sizeof(buf), "lo");
+	else
+		snprintf(buf, sizeof(buf), "ifindex %u", ifindex);
+	entry->if_name = strdup(buf);
+	if (!entry->if_name) {
+		free(entry);
+		return NULL;
+	}
+	entry->ns = ns;
+	entry->if_index = ifindex;
+	entry->flags = IF_STUB;
+	list_append(&ns->ifaces, node(entry));
+	return entry;
+}
+
+struct if_list_ctx {
+	struct list *result;
+	struct netns_entry *ns;
+	struct nlmsg *ainfo;
+};
+
+static int if_list_add(struct nlmsg *l, void *arg)
+{
+	struct if_list_ctx *ctx = arg;
+	struct if_entry *entry;
+	int err;
+
+	if (!l) {
+		/* the link dump is restarted */
+		if_list_free(ctx->result);
+		return 0;
+	}
+	entry = if_create();
+	if (!entry)
+		return ENOMEM;
+	list_append(ctx->result, node(entry));
+	entry->ns = ctx->ns;
+	if ((err = fill_if_link(entry, l)))
+		return err;
+	return fill_if_addr(entry, ctx->ainfo);
+}
+
 int if_list(struct list *result, struct netns_entry *ns)
 {
-	struct nl_handle hnd;
-	struct nlmsg *linfo, *ainfo;
+	struct if_list_ctx ctx = { .result = result, .ns = ns };
 	struct if_entry *entry;
+	struct nl_handle *hnd;
+	struct nlmsg *req;
 	int err;
 
 	list_init(result);
 
-	if ((err = rtnl_open(&hnd)))
-		return err;
-	err = rtnl_ifi_dump(&hnd, RTM_GETLINK, AF_UNSPEC, &linfo);
-	if (err)
-		goto out_close;
-	err = rtnl_ifi_dump(&hnd, RTM_GETADDR, AF_UNSPEC, &ainfo);
-	if (err)
-		goto out_linfo;
+	if (prefetch_get(ns, PREFETCH_ADDR, &ctx.ainfo)) {
+		if ((err = netns_nl_get(ns, NETLINK_ROUTE, &hnd)))
+			return err;
+		req = dump_addr_req();
+		if (!req)
+			return ENOMEM;
+		err = nl_exchange(hnd, req, &ctx.ainfo);
+		nlmsg_free(req);
+		if (err)
+			return err;
+	}
 
-	for_each_nlmsg(l, linfo) {
-		entry = if_create();
-		if (!entry) {
+	/* The link dump can be large, parse it as it arrives. The handlers
+	 * scan only after the dump is complete: they may block (teamd,
+	 * ethtool, sysfs) and their warnings would be duplicated by
+	 * a restarted dump. */
+	if ((err = prefetch_dump(ns, PREFETCH_LINK, if_list_add, &ctx)) < 0) {
+		if ((err = netns_nl_get(ns, NETLINK_ROUTE, &hnd)))
+			goto out;
+		req = rtnl_link_dump_req();
+		if (!req) {
 			err = ENOMEM;
-			goto out_ainfo;
+			goto out;
 		}
-		list_append(result, node(entry));
-		entry->ns = ns;
-		if ((err = fill_if_link(entry, l)))
-			goto out_ainfo;
-		if ((err = fill_if_addr(entry, ainfo)))
-			goto out_ainfo;
-		if ((err = if_handler_scan(entry)))
-			goto out_ainfo;
+		err = nl_dump(hnd, req, if_list_add, &ctx);
+		nlmsg_free(req);
 	}
-	err = 0;
-
-out_ainfo:
-	nlmsg_free(ainfo);
-out_linfo:
-	nlmsg_free(linfo);
-out_close:
-	nl_close(&hnd);
+	if (err)
+		goto out;
+	list_for_each(entry, *result)
+		if ((err = if_handler_scan(entry)))
+			goto out;
+
+out:
+	nlmsg_free(ctx.ainfo);
 	return err;
 }
 
@@ -323,6 +428,7 @@ static void if_list_destruct(struct if_entry *entry)
 	free(entry->edge_label);
 	free(entry->driver);
 	free(entry->sub_driver);
+	free(entry->phys_port_name);
 	mac_addr_destruct(&entry->mac_addr);
 	label_free_property(&entry->properties);
 	list_free(&entry->xdp, NULL);
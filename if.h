@@ -69,9 +69,11 @@ struct if_entry {
 	/* netns relation without peer/child */
 	struct netns_entry *link_net;
 
-	/* IOV fields */
+	/* IOV fields; the PCI paths are PCI addresses of the functions */
+	int pci_known;			/* pci_path is valid even if NULL */
 	char *pci_path;
 	char *pci_physfn_path;
+	char *phys_port_name;
 	struct if_entry *physfn;
 
 	/* handler fields */
@@ -90,10 +92,12 @@ struct if_entry {
 #define IF_INTERNAL		8
 #define IF_LINK_WEAK		16
 #define IF_PASSIVE_SLAVE	32
+#define IF_STUB			64
 
 int if_list(struct list *result, struct netns_entry *ns);
 void if_list_free(struct list *list);
 struct if_entry *if_create(void);
+struct if_entry *if_create_stub(struct netns_entry *ns, unsigned int ifindex);
 
 int if_add_warning(struct if_entry *entry, char *fmt, ...);
 
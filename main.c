@@ -21,7 +21,13 @@
 #include <syscall.h>
 #include <unistd.h>
 #include "args.h"
+#include "batch.h"
+#include "dump.h"
+#include "filter.h"
+#include "netlink.h"
 #include "netns.h"
+#include "seed.h"
+#include "stats.h"
 #include "utils.h"
 #include "version.h"
 
@@ -127,6 +133,13 @@ int main(int argc, char **argv)
 	int netns_ok, err;
 
 	arg_register_batch(options, ARRAY_SIZE(options));
+	stats_register();
+	netns_register();
+	batch_register();
+	dump_register();
+	netlink_register();
+	filter_register();
+	seed_register();
 	register_frontends();
 	register_handlers();
 	if ((err = arg_parse(argc, argv)))
@@ -157,6 +170,10 @@ int main(int argc, char **argv)
 	global_handler_cleanup(&netns_list);
 	netns_list_free(&netns_list);
 	frontend_cleanup();
+	stats_print();
+	stats_cleanup();
+	filter_cleanup();
+	seed_cleanup();
 
 	return 0;
 }
@@ -15,6 +15,7 @@
 
 #include "match.h"
 #include <stdlib.h>
+#include "hash.h"
 #include "if.h"
 #include "master.h"
 #include "netns.h"
@@ -66,11 +67,8 @@ struct netns_entry *match_netnsid(int netnsid, struct netns_entry *current)
 {
 	struct netns_id *ptr;
 
-	list_for_each(ptr, current->ids) {
-		if (ptr->id == netnsid)
-			return ptr->ns;
-	}
-	return NULL;
+	ptr = hash_entry(hash_find(&current->ids, netnsid), struct netns_id, h);
+	return ptr ? ptr->ns : NULL;
 }
 
 struct if_entry *match_if_netnsid(unsigned int ifindex, int netnsid,
@@ -87,6 +85,8 @@ struct if_entry *match_if_netnsid(unsigned int ifindex, int netnsid,
 			return entry;
 	}
 
+	if (ptr->stub)
+		return if_create_stub(ptr, ifindex);
 	return NULL;
 }
 
@@ -102,8 +102,12 @@ void match_all_netnsid(struct list *netns_list)
 					link_set(match_if_netnsid(entry->link_index,
 								  entry->link_netnsid,
 								  ns), entry);
-				else
+				else {
 					entry->link_net = match_netnsid(entry->link_netnsid, ns);
+					/* frontends point to the loopback */
+					if (entry->link_net && entry->link_net->stub)
+						match_if_netnsid(1, entry->link_netnsid, ns);
+				}
 			}
 			if (entry->peer_netnsid >= 0)
 				peer_set(entry, match_if_netnsid(entry->peer_index,
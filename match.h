@@ -65,6 +65,8 @@ static inline void match_init(struct match_desc *desc)
 	memset(desc, 0, sizeof(struct match_desc));
 }
 
+/* Find name space using netnsid. */
+struct netns_entry *match_netnsid(int netnsid, struct netns_entry *current);
 /* Find interface using netnsid. */
 struct if_entry *match_if_netnsid(unsigned int ifindex, int netnsid,
 				  struct netns_entry *current);
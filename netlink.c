@@ -19,23 +19,82 @@
 #include <linux/genetlink.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
-#include <poll.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
+#include "args.h"
 #include "list.h"
+#include "stats.h"
 #include "utils.h"
 
-#define NLMSG_BASIC_SIZE	16384
+#include "compat.h"
 
+#define NLMSG_BASIC_SIZE	16384
+#define NL_RECV_SIZE		32768
+/* The receive buffer does not grow beyond the socket buffer, unless
+ * a single datagram is larger. */
+#define NL_RECV_MAX		1048576
 #define NL_TIMEOUT_MS		500
 #define NL_RETRY_COUNT		16
+/* Delay before the first restart of an interrupted dump; doubles with
+ * every further restart up to the maximum. */
+#define NL_BACKOFF_US		1000
+#define NL_BACKOFF_MAX_US	128000
+
+static int retries = NL_RETRY_COUNT;
+static int inconsistent_ok;
+static __thread unsigned int inconsistent_dumps;
+
+static int set_inconsistent_ok(_unused char *arg)
+{
+	inconsistent_ok = 1;
+	return 0;
+}
+
+static struct arg_option options[] = {
+	{ .long_name = "dump-retries", .short_name = '\0', .has_arg = 1,
+	  .type = ARG_INT, .action.int_var = &retries,
+	  .help = "number of restarts of an interrupted netlink dump (default 16)",
+	},
+	{ .long_name = "inconsistent-ok", .short_name = '\0', .has_arg = 0,
+	  .type = ARG_CALLBACK, .action.callback = set_inconsistent_ok,
+	  .help = "use a dump still interrupted after the last restart",
+	},
+};
+
+void netlink_register(void)
+{
+	arg_register_batch(options, ARRAY_SIZE(options));
+}
+
+int nl_dump_retries(void)
+{
+	return retries;
+}
+
+int nl_dump_inconsistent_ok(void)
+{
+	return inconsistent_ok;
+}
+
+unsigned int nl_inconsistent_dumps(void)
+{
+	return inconsistent_dumps;
+}
+
+void nl_inconsistent_dump(void)
+{
+	inconsistent_dumps++;
+}
 
 int nl_open(struct nl_handle *hnd, int family)
 {
+	struct timeval tv = { .tv_usec = NL_TIMEOUT_MS * 1000 };
 	int bufsize;
 	int err;
 	struct sockaddr_nl sa;
@@ -44,13 +103,20 @@ int nl_open(struct nl_handle *hnd, int family)
 	hnd->fd = socket(AF_NETLINK, SOCK_RAW, family);
 	if (hnd->fd < 0)
 		return -errno;
+	hnd->proto = family;
 	hnd->seq = 0;
+	hnd->rsize = NL_RECV_SIZE;
+	hnd->peek = 0;
+	hnd->dump_intr = 0;
 	bufsize = 32768;
 	if (setsockopt(hnd->fd, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize)) < 0)
 		goto err_out;
-	bufsize = 1048576;
+	bufsize = NL_RECV_MAX;
 	if (setsockopt(hnd->fd, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize)) < 0)
 		goto err_out;
+	/* Blocking receives time out instead of waiting in poll first. */
+	if (setsockopt(hnd->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0)
+		goto err_out;
 
 	memset(&sa, 0, sizeof(sa));
 	sa.nl_family = AF_NETLINK;
@@ -60,6 +126,14 @@ int nl_open(struct nl_handle *hnd, int family)
 	if (getsockname(hnd->fd, (struct sockaddr *)&sa, &sa_len) < 0)
 		goto err_out;
 	hnd->pid = sa.nl_pid;
+
+	/* Let the kernel filter the dumps. Not supported before Linux 4.20;
+	 * the requests are fine without it, too. */
+	if (family == NETLINK_ROUTE) {
+		bufsize = 1;
+		setsockopt(hnd->fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &bufsize,
+			   sizeof(bufsize));
+	}
 	return 0;
 
 err_out:
@@ -96,6 +170,7 @@ static int nlmsg_realloc(struct nlmsg *msg, unsigned int min_len)
 	unsigned int new_alloc = msg->allocated;
 	void *new_buf;
 
+	assert(!msg->rbuf);
 	if (new_alloc >= min_len)
 		return 0;
 	while (new_alloc < min_len)
@@ -108,14 +183,43 @@ static int nlmsg_realloc(struct nlmsg *msg, unsigned int min_len)
 	return 0;
 }
 
+/* Receive buffer. recvmsg writes directly to data; the struct nlmsg views
+ * of the received messages are stored after the data and each of them
+ * holds a reference. */
+struct nl_rbuf {
+	unsigned long refs;
+	char data[];
+};
+
+static struct nl_rbuf *nl_rbuf_new(unsigned int size)
+{
+	struct nl_rbuf *rbuf;
+
+	rbuf = malloc(sizeof(*rbuf) + size);
+	if (rbuf)
+		rbuf->refs = 1;
+	return rbuf;
+}
+
+static void nl_rbuf_put(struct nl_rbuf *rbuf)
+{
+	if (!--rbuf->refs)
+		free(rbuf);
+}
+
 void nlmsg_free(struct nlmsg *msg)
 {
 	struct nlmsg *next;
 
 	while (msg) {
 		next = msg->next;
-		free(msg->buf);
-		free(msg);
+		if (msg->rbuf) {
+			/* the view itself lives in the buffer */
+			nl_rbuf_put(msg->rbuf);
+		} else {
+			free(msg->buf);
+			free(msg);
+		}
 		msg = next;
 	}
 }
@@ -200,32 +304,55 @@ static void nlmsg_reset_start(struct nlmsg *msg)
 	msg->start = NLMSG_ALIGN(sizeof(struct nlmsghdr));
 }
 
-struct nlattr **nlmsg_attrs(struct nlmsg *msg, int max)
+static int nla_valid(const struct nlattr *nla, const struct nla_policy *policy)
 {
-	struct nlattr **tb;
-
-	tb = calloc(max + 1, sizeof(struct nlattr *));
-	if (!tb)
-		return NULL;
-	for_each_nla(a, msg) {
-		if (a->nla_type <= max)
-			tb[a->nla_type] = a;
+	static const unsigned short type_len[] = {
+		[NLA_U8] = sizeof(uint8_t),
+		[NLA_U16] = sizeof(uint16_t),
+		[NLA_U32] = sizeof(uint32_t),
+		[NLA_U64] = sizeof(uint64_t),
+		[NLA_STRING] = 1,
+	};
+	unsigned int len = nla_len(nla);
+
+	switch (policy->type) {
+	case NLA_UNSPEC:
+	case NLA_NESTED:
+		return 1;
+	case NLA_BINARY:
+		return len >= policy->len;
+	case NLA_STRING:
+		return len && memchr(nla_read(nla), '\0', len);
 	}
-	return tb;
+	return len >= type_len[policy->type];
 }
 
-struct nlattr **nla_nested_attrs(struct nlattr *nla, int max)
+void nla_parse(struct nlattr **tb, int max, const struct nla_policy *policy,
+	       const void *buf, int len)
 {
-	struct nlattr **tb;
+	unsigned int type;
 
-	tb = calloc(max + 1, sizeof(struct nlattr *));
-	if (!tb)
-		return NULL;
-	for_each_nla_nested(a, nla) {
-		if (a->nla_type <= max)
-			tb[a->nla_type] = a;
+	memset(tb, 0, (max + 1) * sizeof(*tb));
+	for_each_nla_buf(a, buf, len) {
+		type = a->nla_type & NLA_TYPE_MASK;
+		if (type > (unsigned int)max)
+			continue;
+		if (policy && !nla_valid(a, &policy[type]))
+			continue;
+		tb[type] = a;
 	}
-	return tb;
+}
+
+void nlmsg_parse(struct nlmsg *msg, struct nlattr **tb, int max,
+		 const struct nla_policy *policy)
+{
+	nla_parse(tb, max, policy, msg->buf + msg->start, msg->len - msg->start);
+}
+
+void nla_parse_nested(struct nlattr **tb, int max, const struct nla_policy *policy,
+		      const struct nlattr *nla)
+{
+	nla_parse(tb, max, policy, nla_read(nla), nla_len(nla));
 }
 
 int nla_put(struct nlmsg *msg, int type, const void *data, int len)
@@ -255,133 +382,395 @@ static int nl_send(struct nl_handle *hnd, struct iovec *iov, int iovlen)
 	src->nlmsg_seq = ++hnd->seq;
 	if (sendmsg(hnd->fd, &msg, 0) < 0)
 		return errno;
+	hnd->peek = !!(src->nlmsg_flags & NLM_F_DUMP);
+	hnd->dump_intr = 0;
 	return 0;
 }
 
-static int nl_recv(struct nl_handle *hnd, struct nlmsg **dest, int is_dump)
+/* State of a reply being received. Messages are either collected to
+ * the *dest chain (cb is NULL) or passed to cb one by one. */
+struct nl_recv_state {
+	int is_dump;
+	int intr;
+	/* pass on the messages even after an interruption */
+	int keep;
+	struct nlmsg **dest, *tail;
+	nl_dump_cb cb;
+	void *ctx;
+	int cb_err;
+};
+
+/* Processes one received datagram. Returns 0 if the reply is complete,
+ * EAGAIN if more data is expected or a positive error code. *rbuf may
+ * be reallocated; the caller's reference is kept. */
+static int nl_recv_buf(struct nl_handle *hnd, struct nl_rbuf **rbuf, int len,
+		       struct nl_recv_state *st)
+{
+	struct nlmsg *entry, *views = NULL, view;
+	struct nl_rbuf *new_rbuf;
+	struct nlmsghdr *n;
+	int count = 0, rest, err;
+	size_t off;
+
+	if (!st->cb) {
+		/* Make room for the views. Usually, this shrinks the buffer. */
+		for (n = (void *)(*rbuf)->data, rest = len; NLMSG_OK(n, rest); n = NLMSG_NEXT(n, rest))
+			count++;
+		off = (len + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+		new_rbuf = realloc(*rbuf, sizeof(**rbuf) + off + count * sizeof(*views));
+		if (!new_rbuf)
+			return ENOMEM;
+		*rbuf = new_rbuf;
+		views = (struct nlmsg *)(new_rbuf->data + off);
+	}
+
+	for (n = (void *)(*rbuf)->data; NLMSG_OK(n, len); n = NLMSG_NEXT(n, len)) {
+		if (n->nlmsg_pid != hnd->pid || n->nlmsg_seq != hnd->seq)
+			continue;
+		if (st->is_dump && n->nlmsg_type == NLMSG_DONE)
+			return 0;
+		if (n->nlmsg_type == NLMSG_ERROR) {
+			struct nlmsgerr *nlerr = (struct nlmsgerr *)NLMSG_DATA(n);
+
+			return -nlerr->error;
+		}
+		if (st->is_dump && (n->nlmsg_flags & NLM_F_DUMP_INTR))
+			st->intr = 1;
+		if (st->cb) {
+			/* The rest of an interrupted dump is only drained. */
+			if (st->intr && !st->keep)
+				continue;
+			memset(&view, 0, sizeof(view));
+			view.rbuf = *rbuf;
+			view.buf = n;
+			view.len = n->nlmsg_len;
+			nlmsg_reset_start(&view);
+			if ((err = st->cb(&view, st->ctx))) {
+				st->cb_err = err;
+				return err;
+			}
+		} else {
+			entry = views++;
+			memset(entry, 0, sizeof(*entry));
+			entry->rbuf = *rbuf;
+			(*rbuf)->refs++;
+			entry->buf = n;
+			entry->len = n->nlmsg_len;
+			nlmsg_reset_start(entry);
+			if (!*st->dest)
+				*st->dest = entry;
+			else
+				st->tail->next = entry;
+			st->tail = entry;
+		}
+
+		if (!st->is_dump)
+			return 0;
+	}
+	return EAGAIN;
+}
+
+static void nl_recv_grow(struct nl_handle *hnd, int len)
+{
+	unsigned int size = hnd->rsize;
+
+	while (size < (unsigned int)len && size < NL_RECV_MAX)
+		size *= 2;
+	hnd->rsize = size < (unsigned int)len ? (unsigned int)len : size;
+}
+
+/* Receives one datagram into a new buffer. The first datagram of a dump
+ * is peeked at to size the buffer, as dumps with large messages (e.g.
+ * links with many VFs) are sent one message per datagram. Returns the
+ * length, 0 for a datagram to be ignored, or -errno. -ENOBUFS means that
+ * data was lost, either because the socket overran or because
+ * a datagram did not fit; the buffer is grown in the latter case. */
+static int nl_recv_dgram(struct nl_handle *hnd, struct nl_rbuf **rbuf, int flags)
 {
 	struct sockaddr_nl sa = {
 		.nl_family = AF_NETLINK,
 	};
-	struct iovec iov;
+	struct iovec iov = { NULL, 0 };
 	struct msghdr msg = {
 		.msg_name = &sa,
 		.msg_namelen = sizeof(sa),
 		.msg_iov = &iov,
 		.msg_iovlen = 1,
 	};
-	char buf[16384];
+	int len;
+
+	if (hnd->peek) {
+		len = recvmsg(hnd->fd, &msg, flags | MSG_PEEK | MSG_TRUNC);
+		if (len < 0)
+			return -errno;
+		hnd->peek = 0;
+		nl_recv_grow(hnd, len);
+	}
+	*rbuf = nl_rbuf_new(hnd->rsize);
+	if (!*rbuf)
+		return -ENOMEM;
+	iov.iov_base = (*rbuf)->data;
+	iov.iov_len = hnd->rsize;
+	len = recvmsg(hnd->fd, &msg, flags | MSG_TRUNC);
+	if (len < 0) {
+		len = -errno;
+	} else if (!len) {
+		len = -EPIPE;
+	} else if (sa.nl_pid) {
+		/* not from the kernel */
+		len = 0;
+	} else if ((unsigned int)len > iov.iov_len) {
+		nl_recv_grow(hnd, len);
+		len = -ENOBUFS;
+	} else {
+		return len;
+	}
+	nl_rbuf_put(*rbuf);
+	*rbuf = NULL;
+	if (len == -ENOBUFS)
+		stats_count("netlink datagrams lost", 1);
+	return len;
+}
+
+static int nl_recv(struct nl_handle *hnd, struct nl_recv_state *st)
+{
+	struct nl_rbuf *rbuf;
 	int len, err;
-	struct nlmsghdr *n;
-	struct nlmsg *ptr = NULL; /* GCC false positive */
-	struct nlmsg *entry;
-	struct pollfd pfd;
 
-	*dest = NULL;
-	pfd.fd = hnd->fd;
-	pfd.events = POLLIN;
 	while (1) {
-		iov.iov_base = buf;
-		iov.iov_len = sizeof(buf);
-		err = poll(&pfd, 1, NL_TIMEOUT_MS);
-		if (err < 0) {
-			err = errno;
-			goto err_out;
+		len = nl_recv_dgram(hnd, &rbuf, 0);
+		if (len == -ENOBUFS) {
+			if (!st->is_dump) {
+				/* the reply may be gone; ask again */
+				err = EINTR;
+				goto err_out;
+			}
+			/* Drain the rest of the dump, then restart it. */
+			st->intr = 1;
+			continue;
 		}
-		if (err == 0 || !(pfd.revents & POLLIN)) {
+		if (len == -EAGAIN || len == -EWOULDBLOCK) {
 			err = ETIME;
 			goto err_out;
 		}
-		len = recvmsg(hnd->fd, &msg, 0);
 		if (len < 0) {
-			err = errno;
-			goto err_out;
-		}
-		if (!len) {
-			err = EPIPE;
+			err = -len;
 			goto err_out;
 		}
-		if (sa.nl_pid) {
-			/* not from the kernel */
+		if (!len)
 			continue;
+		err = nl_recv_buf(hnd, &rbuf, len, st);
+		nl_rbuf_put(rbuf);
+		if (err == EAGAIN)
+			continue;
+		if (err)
+			goto err_out;
+		return 0;
+	}
+err_out:
+	if (st->dest) {
+		nlmsg_free(*st->dest);
+		*st->dest = NULL;
+	}
+	return err;
+}
+
+/* Waits before a restart of an interrupted dump to let a burst of changes
+ * settle. The delay is randomized, so that the scans of name spaces
+ * sharing the churn do not restart in lockstep. */
+long nl_backoff_us(struct nl_handle *hnd, int attempt)
+{
+	unsigned int seed = hnd->pid ^ (hnd->seq << 16);
+	long delay = NL_BACKOFF_MAX_US;
+
+	if (attempt < 16 && (NL_BACKOFF_US << attempt) < NL_BACKOFF_MAX_US)
+		delay = NL_BACKOFF_US << attempt;
+	return delay / 2 + rand_r(&seed) % (delay / 2 + 1);
+}
+
+static void nl_backoff(struct nl_handle *hnd, int attempt)
+{
+	long delay = nl_backoff_us(hnd, attempt);
+	struct timespec ts;
+
+	ts.tv_sec = delay / 1000000;
+	ts.tv_nsec = delay % 1000000 * 1000;
+	nanosleep(&ts, NULL);
+}
+
+void nl_dump_stats(struct nl_handle *hnd, int type, const char **time,
+		   const char **restarts)
+{
+	if (hnd->proto == NETLINK_ROUTE) {
+		switch (type) {
+		case RTM_GETLINK:
+			*time = "netlink link dumps";
+			*restarts = "netlink link dump restarts";
+			return;
+		case RTM_GETADDR:
+			*time = "netlink addr dumps";
+			*restarts = "netlink addr dump restarts";
+			return;
+		case RTM_GETROUTE:
+			*time = "netlink route dumps";
+			*restarts = "netlink route dump restarts";
+			return;
+		case RTM_GETNSID:
+			*time = "netlink nsid dumps";
+			*restarts = "netlink nsid dump restarts";
+			return;
 		}
-		for (n = (struct nlmsghdr *)buf; NLMSG_OK(n, len); n = NLMSG_NEXT(n, len)) {
-			if (n->nlmsg_pid != hnd->pid || n->nlmsg_seq != hnd->seq)
-				continue;
-			if (is_dump && n->nlmsg_type == NLMSG_DONE)
-				return 0;
-			if (n->nlmsg_type == NLMSG_ERROR) {
-				struct nlmsgerr *nlerr = (struct nlmsgerr *)NLMSG_DATA(n);
+	}
+	*time = "netlink other dumps";
+	*restarts = "netlink other dump restarts";
+}
 
-				err = -nlerr->error;
-				goto err_out;
+/* Sends the request (unless it was already sent) and receives the reply,
+ * retrying interrupted dumps with a backoff. Before a retry, the callback
+ * (if any) is told to discard what it got. With --inconsistent-ok,
+ * the last attempt is used even if interrupted. */
+static int nl_request(struct nl_handle *hnd, struct nlmsg *src,
+		      struct nl_recv_state *st, int sent)
+{
+	struct iovec iov = {
+		.iov_base = src->buf,
+		.iov_len = src->len,
+	};
+	const char *time_name = NULL, *restarts_name = NULL;
+	struct stats_timer timer;
+	int attempt = 0;
+	int err, cb_err;
+
+	st->is_dump = !!(nlmsg_get_hdr(src)->nlmsg_flags & NLM_F_DUMP);
+	if (st->is_dump) {
+		nl_dump_stats(hnd, nlmsg_get_hdr(src)->nlmsg_type, &time_name,
+			      &restarts_name);
+		stats_timer_start(&timer);
+	}
+	while (1) {
+		st->intr = 0;
+		st->keep = inconsistent_ok && attempt >= retries;
+		if (st->dest)
+			*st->dest = NULL;
+		st->tail = NULL;
+		if (!sent) {
+			err = nl_send(hnd, &iov, 1);
+			if (err)
+				break;
+		}
+		sent = 0;
+		err = nl_recv(hnd, st);
+		if (st->cb_err) {
+			err = st->cb_err;
+			break;
+		}
+		if (!err && st->intr) {
+			if (st->keep) {
+				nl_inconsistent_dump();
+				break;
 			}
-			entry = nlmsg_alloc(n->nlmsg_len);
-			if (!entry) {
-				err = ENOMEM;
-				goto err_out;
+			if (st->dest) {
+				nlmsg_free(*st->dest);
+				*st->dest = NULL;
 			}
-			if (!*dest)
-				*dest = entry;
-			else
-				ptr->next = entry;
-			ptr = entry;
-
-			err = nlmsg_put_raw(entry, n, n->nlmsg_len, 0);
-			if (err)
-				goto err_out;
-			nlmsg_reset_start(entry);
-
-			if (!is_dump)
-				return 0;
+			err = EINTR;
+		}
+		if (err != ETIME && err != EAGAIN && err != EINTR)
+			break;
+		if (attempt >= retries)
+			break;
+		if (st->cb && (cb_err = st->cb(NULL, st->ctx))) {
+			err = cb_err;
+			break;
 		}
+		if (restarts_name)
+			stats_count(restarts_name, 1);
+		/* a timeout has waited long enough already */
+		if (err == EINTR)
+			nl_backoff(hnd, attempt);
+		attempt++;
 	}
-err_out:
-	nlmsg_free(*dest);
-	*dest = NULL;
+	if (time_name)
+		stats_timer_stop(&timer, time_name);
 	return err;
 }
 
-static int nl_check_interrupted_dump(struct nlmsg *entry)
+int nl_exchange(struct nl_handle *hnd, struct nlmsg *src, struct nlmsg **dest)
 {
-	for (; entry; entry = entry->next)
-		if (nlmsg_get_hdr(entry)->nlmsg_flags & NLM_F_DUMP_INTR)
-			return 1;
-	return 0;
+	struct nl_recv_state st = { .dest = dest };
+
+	return nl_request(hnd, src, &st, 0);
 }
 
-int nl_exchange(struct nl_handle *hnd, struct nlmsg *src, struct nlmsg **dest)
+int nl_dump(struct nl_handle *hnd, struct nlmsg *src, nl_dump_cb cb, void *ctx)
+{
+	struct nl_recv_state st = { .cb = cb, .ctx = ctx };
+
+	return nl_request(hnd, src, &st, 0);
+}
+
+int nl_dump_finish(struct nl_handle *hnd, struct nlmsg *src, struct nlmsg **dest)
+{
+	struct nl_recv_state st = { .dest = dest };
+
+	return nl_request(hnd, src, &st, 1);
+}
+
+int nl_dump_finish_cb(struct nl_handle *hnd, struct nlmsg *src, nl_dump_cb cb,
+		      void *ctx)
+{
+	struct nl_recv_state st = { .cb = cb, .ctx = ctx };
+
+	return nl_request(hnd, src, &st, 1);
+}
+
+int nl_dump_start(struct nl_handle *hnd, struct nlmsg *src)
 {
 	struct iovec iov = {
 		.iov_base = src->buf,
 		.iov_len = src->len,
 	};
-	int is_dump;
-	int err;
-	int retry = NL_RETRY_COUNT;
-
-	is_dump = !!(nlmsg_get_hdr(src)->nlmsg_flags & NLM_F_DUMP);
-	while (1) {
-		if (!retry--)
-			return EINTR;
 
-		err = nl_send(hnd, &iov, 1);
-		if (err)
-			return err;
-		err = nl_recv(hnd, dest, is_dump);
-		if (err == ETIME || err == EAGAIN || err == EINTR)
-			continue;
-		if (err)
-			return err;
+	return nl_send(hnd, &iov, 1);
+}
 
-		if (is_dump && nl_check_interrupted_dump(*dest)) {
-			nlmsg_free(*dest);
-			*dest = NULL;
-			continue;
-		}
+int nl_dump_recv(struct nl_handle *hnd, struct nlmsg **dest, struct nlmsg **tail)
+{
+	struct nl_recv_state st = { .is_dump = 1 };
+	struct nl_rbuf *rbuf;
+	int len, err;
 
-		return 0;
+	len = nl_recv_dgram(hnd, &rbuf, MSG_DONTWAIT);
+	if (len == -ENOBUFS) {
+		/* drain the rest of the dump, then report it interrupted */
+		hnd->dump_intr = 1;
+		return EAGAIN;
+	}
+	if (len == -EAGAIN || len == -EWOULDBLOCK || !len)
+		return EAGAIN;
+	if (len < 0) {
+		err = -len;
+		goto err_out;
 	}
+	st.intr = hnd->dump_intr;
+	st.dest = dest;
+	st.tail = *tail;
+	err = nl_recv_buf(hnd, &rbuf, len, &st);
+	nl_rbuf_put(rbuf);
+	*tail = st.tail;
+	hnd->dump_intr = st.intr;
+	if (err == EAGAIN)
+		return EAGAIN;
+	if (!err && st.intr)
+		return EINTR;
+	if (!err)
+		return 0;
+
+err_out:
+	nlmsg_free(*dest);
+	*dest = NULL;
+	*tail = NULL;
+	return err;
 }
 
 int rtnl_open(struct nl_handle *hnd)
@@ -404,17 +793,19 @@ struct nlmsg *rtnlmsg_new(int type, int family, int flags, int size)
 	return res;
 }
 
-int rtnl_ifi_dump(struct nl_handle *hnd, int type, int family, struct nlmsg **dest)
+struct nlmsg *rtnl_link_dump_req(void)
 {
-	struct nlmsg *req;
-	int err;
+	struct nlmsg *res;
 
-	req = rtnlmsg_new(type, family, NLM_F_DUMP, sizeof(struct ifinfomsg));
-	if (!req)
-		return ENOMEM;
-	err = nl_exchange(hnd, req, dest);
-	nlmsg_free(req);
-	return err;
+	res = rtnlmsg_new(RTM_GETLINK, AF_UNSPEC, NLM_F_DUMP, sizeof(struct ifinfomsg));
+	if (!res)
+		return NULL;
+	/* Kernels not knowing the bit ignore it. */
+	if (nla_put_u32(res, IFLA_EXT_MASK, RTEXT_FILTER_SKIP_STATS)) {
+		nlmsg_free(res);
+		return NULL;
+	}
+	return res;
 }
 
 int genl_open(struct nl_handle *hnd)
@@ -437,8 +828,13 @@ struct nlmsg *genlmsg_new(int type, int cmd, int flags)
 	return res;
 }
 
+static const struct nla_policy ctrl_policy[CTRL_ATTR_FAMILY_ID + 1] = {
+	[CTRL_ATTR_FAMILY_ID]	= { .type = NLA_U16 },
+};
+
 unsigned int genl_family_id(struct nl_handle *hnd, const char *name)
 {
+	struct nlattr *tb[CTRL_ATTR_FAMILY_ID + 1];
 	struct nlmsg *req, *resp;
 	int res = 0;
 
@@ -451,12 +847,9 @@ unsigned int genl_family_id(struct nl_handle *hnd, const char *name)
 		goto out_req;
 	if (!nlmsg_get(resp, sizeof(struct genlmsghdr)))
 		goto out_resp;
-	for_each_nla(a, resp) {
-		if (a->nla_type == CTRL_ATTR_FAMILY_ID) {
-			res = nla_read_u16(a);
-			break;
-		}
-	}
+	nlmsg_parse(resp, tb, CTRL_ATTR_FAMILY_ID, ctrl_policy);
+	if (tb[CTRL_ATTR_FAMILY_ID])
+		res = nla_read_u16(tb[CTRL_ATTR_FAMILY_ID]);
 
 out_resp:
 	nlmsg_free(resp);
@@ -25,33 +25,118 @@
 
 struct nl_handle {
 	int fd;
+	int proto;
 	unsigned int pid;
 	unsigned int seq;
+	/* Size of the receive buffer; grows to fit the largest datagram
+	 * seen on the socket. */
+	unsigned int rsize;
+	/* The next datagram is the first one of a dump reply. */
+	int peek;
+	/* The dump being received by nl_dump_recv lost data or was
+	 * interrupted. */
+	int dump_intr;
 };
 
+struct nl_rbuf;
+
+/* Received messages are views into a shared, reference counted receive
+ * buffer (rbuf is set); they cannot be extended by nlmsg_put. */
 struct nlmsg {
 	struct nlmsg *next;
 	void *buf;
 	int start;
 	int len;
 	int allocated;
+	struct nl_rbuf *rbuf;
 };
 
 #define nlmsg_get_hdr(n)	((struct nlmsghdr *)(n)->buf)
 
 /* all netlink families */
 
+void netlink_register(void);
+/* Number of dumps accepted by the calling thread although they were
+ * inconsistent, see --inconsistent-ok. The value only grows;
+ * nl_inconsistent_dump counts one more. */
+unsigned int nl_inconsistent_dumps(void);
+void nl_inconsistent_dump(void);
+/* The retry policy of interrupted dumps, for callers restarting the dumps
+ * on their own: the number of restarts allowed, whether the last attempt
+ * is to be used if still interrupted, and the delay before a restart. */
+int nl_dump_retries(void);
+int nl_dump_inconsistent_ok(void);
+long nl_backoff_us(struct nl_handle *hnd, int attempt);
+/* Names of the --stats counters of a dump of the given message type. */
+void nl_dump_stats(struct nl_handle *hnd, int type, const char **time,
+		   const char **restarts);
+
 int nl_open(struct nl_handle *hnd, int family);
 void nl_close(struct nl_handle *hnd);
 int nl_exchange(struct nl_handle *hnd, struct nlmsg *src, struct nlmsg **dest);
 
+/* Called by nl_dump for every message as it arrives. The message is valid
+ * only during the call and must not be freed. When the dump was
+ * interrupted and is going to be restarted, the callback is called with
+ * msg NULL; everything received so far is to be discarded. A non-zero
+ * return value (a positive error code) aborts the dump and is returned
+ * by nl_dump. */
+typedef int (*nl_dump_cb)(struct nlmsg *msg, void *ctx);
+
+/* Streaming variant of nl_exchange: the reply is not collected, the
+ * messages are passed to cb. */
+int nl_dump(struct nl_handle *hnd, struct nlmsg *src, nl_dump_cb cb, void *ctx);
+
+/* Asynchronous dumps, for use with poll/epoll. Only one dump at a time can
+ * be in progress on a socket. nl_dump_recv reads one datagram without
+ * blocking and appends the messages to *dest; *tail must be NULL for
+ * a new dump. Returns 0 when the dump is complete, EAGAIN when more data
+ * is expected, EINTR when the dump was interrupted or lost data and should
+ * be restarted, or another error. On EINTR, *dest holds the inconsistent
+ * reply; on other errors, it is freed. */
+int nl_dump_start(struct nl_handle *hnd, struct nlmsg *src);
+int nl_dump_recv(struct nl_handle *hnd, struct nlmsg **dest, struct nlmsg **tail);
+
+/* Blocking completion of a dump sent by nl_dump_start, like nl_exchange
+ * and nl_dump. The request is sent again if the dump is interrupted. */
+int nl_dump_finish(struct nl_handle *hnd, struct nlmsg *src, struct nlmsg **dest);
+int nl_dump_finish_cb(struct nl_handle *hnd, struct nlmsg *src, nl_dump_cb cb,
+		      void *ctx);
+
 struct nlmsg *nlmsg_new(int type, int flags);
 void nlmsg_free(struct nlmsg *msg);
 int nlmsg_put(struct nlmsg *msg, const void *data, int len);
 void *nlmsg_get(struct nlmsg *msg, int len);
 void nlmsg_unget(struct nlmsg *msg, int len);
-struct nlattr **nlmsg_attrs(struct nlmsg *msg, int max);
-struct nlattr **nla_nested_attrs(struct nlattr *nla, int max);
+
+/* Attribute policies, indexed by the attribute type. An attribute not
+ * matching its policy is left out of the parsed table as if it was not
+ * present; thus the nla_read_* helpers are safe to use on the parsed
+ * attributes. */
+enum {
+	NLA_UNSPEC,	/* not checked */
+	NLA_U8,
+	NLA_U16,
+	NLA_U32,
+	NLA_U64,
+	NLA_STRING,	/* NUL terminated */
+	NLA_NESTED,
+	NLA_BINARY,	/* at least len bytes */
+};
+
+struct nla_policy {
+	unsigned char type;
+	unsigned short len;
+};
+
+/* Parses the attributes into tb, which has max + 1 entries and is usually
+ * on the stack. policy may be NULL. */
+void nla_parse(struct nlattr **tb, int max, const struct nla_policy *policy,
+	       const void *buf, int len);
+void nlmsg_parse(struct nlmsg *msg, struct nlattr **tb, int max,
+		 const struct nla_policy *policy);
+void nla_parse_nested(struct nlattr **tb, int max, const struct nla_policy *policy,
+		      const struct nlattr *nla);
 
 #define for_each_nlmsg(iter, msg)				\
 	for (struct nlmsg *iter = (msg); iter; iter = iter->next)
@@ -155,7 +240,9 @@ static inline const char *nla_read_str(const struct nlattr *nla)
 
 int rtnl_open(struct nl_handle *hnd);
 struct nlmsg *rtnlmsg_new(int type, int family, int flags, int size);
-int rtnl_ifi_dump(struct nl_handle *hnd, int type, int family, struct nlmsg **dest);
+/* Link dump without statistics; the VF info and the bridge VLAN blocks
+ * are not requested either. */
+struct nlmsg *rtnl_link_dump_req(void);
 
 /* genetlink */
 
@@ -18,59 +18,372 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
 #include <sched.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <syscall.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include "args.h"
+#include "batch.h"
+#include "filter.h"
 #include "handler.h"
+#include "hash.h"
 #include "if.h"
 #include "list.h"
 #include "master.h"
 #include "match.h"
 #include "netlink.h"
+#include "prefetch.h"
+#include "seed.h"
+#include "stats.h"
 #include "sysfs.h"
 
 #include "compat.h"
 
 #define NETNS_RUN_DIR "/var/run/netns"
 
-static long netns_get_kernel_id(const char *path)
+#define PROC_DENTS_BUF_SIZE	65536
+/* minimum number of descriptors held by the netns entries */
+#define NETNS_FD_MIN		16
+
+struct linux_dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+static int jobs = 1;
+static int prefetch;
+
+static int set_prefetch(_unused char *arg)
 {
-	char dest[PATH_MAX], *s, *endptr;
-	ssize_t len;
-	long result;
+	prefetch = 1;
+	return 0;
+}
 
-	len = readlink(path, dest, sizeof(dest));
-	if (len < 0)
-		return -errno;
-	dest[len] = 0;
-	if (strncmp("net:[", dest, 5))
-		return -EINVAL;
-	s = strrchr(dest, ']');
-	if (!s)
+static struct arg_option options[] = {
+	{ .long_name = "jobs", .short_name = 'j', .has_arg = 1,
+	  .type = ARG_INT, .action.int_var = &jobs,
+	  .help = "number of name spaces to scan in parallel",
+	},
+	{ .long_name = "prefetch", .short_name = '\0', .has_arg = 0,
+	  .type = ARG_CALLBACK, .action.callback = set_prefetch,
+	  .help = "dump all name spaces at once before scanning",
+	},
+};
+
+void netns_register(void)
+{
+	arg_register_batch(options, ARRAY_SIZE(options));
+}
+
+/* Index of the netns list by kernel_id. */
+static struct hash netns_index = HASH_INITIALIZER;
+
+/* Device of the nsfs file system, used to validate name space files. */
+static dev_t nsfs_dev;
+
+/* The kernel_id is the inode number of the name space file in nsfs. Both
+ * the /proc/<pid>/ns/net magic links and the bind mounts in
+ * /var/run/netns resolve to that inode, thus a stat is enough and we don't
+ * need to switch into the name space. */
+static long netns_get_kernel_id(const struct stat *st)
+{
+	if (nsfs_dev && st->st_dev != nsfs_dev)
 		return -EINVAL;
-	*s = '\0';
-	s = dest + 5;
-	result = strtol(s, &endptr, 10);
-	if (!*s || *endptr)
+	return st->st_ino;
+}
+
+static long netns_get_kernel_id_fd(int fd)
+{
+	struct stat st;
+	int type;
+
+	if (fstat(fd, &st) < 0)
+		return -errno;
+	/* Bind mounts of other name space types could be present in
+	 * /var/run/netns. Older kernels do not support NS_GET_NSTYPE,
+	 * assume a net name space there. */
+	type = ioctl(fd, NS_GET_NSTYPE);
+	if (type >= 0 && type != CLONE_NEWNET)
 		return -EINVAL;
-	return result;
+	return netns_get_kernel_id(&st);
 }
 
-static struct netns_entry *netns_check_duplicate(struct list *netns_list,
-						 long int kernel_id)
+/* Entries holding file descriptors (the name space fd and the cached
+ * netlink sockets) are kept in a LRU list. When the number of descriptors
+ * exceeds the budget, the least recently used entries are closed and
+ * reopened later on demand. The lock protects the list, the counters and
+ * the fd, rtnl, genl and pinned fields of all entries. */
+static pthread_mutex_t netns_fd_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct netns_entry *netns_lru_head, *netns_lru_tail;
+static unsigned int netns_fd_count;
+static unsigned int netns_fd_budget = UINT_MAX;
+static int netns_supported;
+
+static void netns_fd_init(void)
 {
-	struct netns_entry *ns;
+	struct rlimit rl;
 
-	list_for_each(ns, *netns_list)
-		if (ns->kernel_id == kernel_id)
-			return ns;
-	return NULL;
+	if (getrlimit(RLIMIT_NOFILE, &rl) < 0 || rl.rlim_cur == RLIM_INFINITY)
+		return;
+	/* Leave the other half to the rest of the program. */
+	netns_fd_budget = rl.rlim_cur / 2;
+	if (netns_fd_budget < NETNS_FD_MIN)
+		netns_fd_budget = NETNS_FD_MIN;
+}
+
+static unsigned int netns_fd_held(struct netns_entry *ns)
+{
+	return (ns->fd >= 0) + !!ns->rtnl + !!ns->genl;
+}
+
+static void netns_lru_unlink(struct netns_entry *ns)
+{
+	if (ns->lru_prev)
+		ns->lru_prev->lru_next = ns->lru_next;
+	else if (netns_lru_head == ns)
+		netns_lru_head = ns->lru_next;
+	else
+		return;
+	if (ns->lru_next)
+		ns->lru_next->lru_prev = ns->lru_prev;
+	else
+		netns_lru_tail = ns->lru_prev;
+	ns->lru_prev = ns->lru_next = NULL;
+}
+
+/* Moves the entry to the head of the LRU list. */
+static void netns_lru_touch(struct netns_entry *ns)
+{
+	netns_lru_unlink(ns);
+	if (!netns_fd_held(ns))
+		return;
+	ns->lru_next = netns_lru_head;
+	if (netns_lru_head)
+		netns_lru_head->lru_prev = ns;
+	else
+		netns_lru_tail = ns;
+	netns_lru_head = ns;
+}
+
+static void netns_fd_close(struct netns_entry *ns)
+{
+	netns_fd_count -= netns_fd_held(ns);
+	netns_lru_unlink(ns);
+	if (ns->fd >= 0) {
+		close(ns->fd);
+		ns->fd = -1;
+	}
+	if (ns->rtnl) {
+		nl_close(ns->rtnl);
+		free(ns->rtnl);
+		ns->rtnl = NULL;
+	}
+	if (ns->genl) {
+		nl_close(ns->genl);
+		free(ns->genl);
+		ns->genl = NULL;
+	}
+}
+
+/* Makes room for n more descriptors. Pinned entries are skipped; if
+ * everything is pinned, the budget is exceeded. */
+static void netns_fd_reserve(unsigned int n)
+{
+	struct netns_entry *ns, *prev;
+
+	for (ns = netns_lru_tail; ns && netns_fd_count + n > netns_fd_budget; ns = prev) {
+		prev = ns->lru_prev;
+		if (ns->pinned)
+			continue;
+		netns_fd_close(ns);
+		stats_count("netns fd evictions", 1);
+	}
+}
+
+static int netns_open_checked(int dirfd, const char *path, long kernel_id)
+{
+	struct stat st;
+	int fd;
+
+	fd = openat(dirfd, path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) < 0 || netns_get_kernel_id(&st) != kernel_id) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+typedef int (*netns_proc_cb_f)(int procfd, const char *spid, void *arg);
+
+/* Calls cb for each pid directory in /proc until it returns nonzero.
+ * Returns that value. */
+static int netns_proc_walk(int procfd, netns_proc_cb_f cb, void *arg)
+{
+	struct linux_dirent64 *de;
+	char *buf;
+	long len, pos;
+	int res = 0;
+
+	buf = malloc(PROC_DENTS_BUF_SIZE);
+	if (!buf)
+		return ENOMEM;
+	while (!res && (len = syscall(__NR_getdents64, procfd, buf, PROC_DENTS_BUF_SIZE)) > 0) {
+		for (pos = 0; !res && pos < len; pos += de->d_reclen) {
+			de = (struct linux_dirent64 *)(buf + pos);
+			if (de->d_name[0] < '0' || de->d_name[0] > '9')
+				continue;
+			if (de->d_type != DT_DIR && de->d_type != DT_UNKNOWN)
+				continue;
+			res = cb(procfd, de->d_name, arg);
+		}
+	}
+	free(buf);
+	return res;
+}
+
+struct netns_rescan {
+	long kernel_id;
+	pid_t pid;
+	int fd;
+};
+
+static int netns_rescan_pid(int procfd, const char *spid, void *arg)
+{
+	struct netns_rescan *r = arg;
+	char path[32];
+	struct stat st;
+
+	snprintf(path, sizeof(path), "%s/ns/net", spid);
+	if (fstatat(procfd, path, &st, 0) < 0 ||
+	    netns_get_kernel_id(&st) != r->kernel_id)
+		return 0;
+	r->fd = netns_open_checked(procfd, path, r->kernel_id);
+	if (r->fd < 0)
+		return 0;
+	r->pid = atol(spid);
+	return 1;
+}
+
+/* The process the name space was found by has exited; look for another
+ * one still living in it. Returns the fd and sets *pid, or returns -1.
+ * Walking /proc is slow, call this without netns_fd_lock held. */
+static int netns_reopen_proc(long kernel_id, pid_t *pid)
+{
+	struct netns_rescan r = { .kernel_id = kernel_id, .fd = -1 };
+	int procfd;
+
+	procfd = open("/proc", O_RDONLY | O_DIRECTORY);
+	if (procfd < 0)
+		return -1;
+	netns_proc_walk(procfd, netns_rescan_pid, &r);
+	close(procfd);
+	stats_count("netns proc rescans", 1);
+	*pid = r.pid;
+	return r.fd;
+}
+
+/* Reopens the name space file the entry was discovered by. The kernel_id
+ * check catches a pid reused by a process in another name space as well as
+ * a replaced /var/run/netns file. Returns ESTALE if the file does not
+ * lead to the name space anymore. */
+static int netns_reopen(struct netns_entry *ns)
+{
+	char path[PATH_MAX];
+
+	if (ns->pid)
+		snprintf(path, sizeof(path), "/proc/%d/ns/net", ns->pid);
+	else if (ns->name)
+		snprintf(path, sizeof(path), "%s/%s", NETNS_RUN_DIR, ns->name);
+	else
+		snprintf(path, sizeof(path), "/proc/1/ns/net");
+	ns->fd = netns_open_checked(AT_FDCWD, path, ns->kernel_id);
+	return ns->fd < 0 ? ESTALE : 0;
+}
+
+/* Makes sure ns->fd is valid. Must be called with netns_fd_lock held;
+ * the lock is dropped while /proc is searched for another process of
+ * the name space. */
+static int netns_fd_get(struct netns_entry *ns)
+{
+	pid_t pid;
+	int fd;
+
+	if (ns->fd >= 0)
+		goto out_touch;
+	if (netns_reopen(ns) && ns->pid) {
+		pthread_mutex_unlock(&netns_fd_lock);
+		fd = netns_reopen_proc(ns->kernel_id, &pid);
+		pthread_mutex_lock(&netns_fd_lock);
+		if (ns->fd >= 0) {
+			/* reopened by another thread meanwhile */
+			if (fd >= 0)
+				close(fd);
+			goto out_touch;
+		}
+		ns->fd = fd;
+		if (fd >= 0)
+			ns->pid = pid;
+	}
+	if (ns->fd < 0)
+		return ESTALE;
+	ns->pinned++;
+	netns_fd_reserve(1);
+	ns->pinned--;
+	netns_fd_count++;
+	stats_count("netns fd reopens", 1);
+out_touch:
+	netns_lru_touch(ns);
+	return 0;
+}
+
+void netns_pin(struct netns_entry *ns)
+{
+	pthread_mutex_lock(&netns_fd_lock);
+	ns->pinned++;
+	pthread_mutex_unlock(&netns_fd_lock);
+}
+
+void netns_unpin(struct netns_entry *ns)
+{
+	pthread_mutex_lock(&netns_fd_lock);
+	ns->pinned--;
+	pthread_mutex_unlock(&netns_fd_lock);
+}
+
+static struct netns_entry *netns_check_duplicate(long int kernel_id)
+{
+	return hash_entry(hash_find(&netns_index, kernel_id),
+			  struct netns_entry, hash_node);
+}
+
+static int netns_list_add(struct list *netns_list, struct netns_entry *entry)
+{
+	int err;
+
+	if ((err = hash_add(&netns_index, &entry->hash_node, entry->kernel_id)))
+		return err;
+	list_append(netns_list, node(entry));
+
+	pthread_mutex_lock(&netns_fd_lock);
+	netns_fd_count += netns_fd_held(entry);
+	netns_lru_touch(entry);
+	netns_fd_reserve(0);
+	pthread_mutex_unlock(&netns_fd_lock);
+	return 0;
 }
 
 static struct netns_entry *netns_create()
@@ -83,20 +396,19 @@ static struct netns_entry *netns_create()
 
 	list_init(&ns->ifaces);
 	list_init(&ns->warnings);
-	list_init(&ns->ids);
+	list_init(&ns->rtables);
+	ns->fd = -1;
 
 	return ns;
 }
 
 static int netns_get_var_entry(struct netns_entry **result,
-			       struct list *netns_list,
 			       const char *name,
 			       struct list *warnings)
 {
 	struct netns_entry *entry;
 	char path[PATH_MAX];
 	long kernel_id;
-	int err;
 
 	*result = entry = netns_create();
 	if (!entry)
@@ -108,17 +420,14 @@ static int netns_get_var_entry(struct netns_entry **result,
 		label_add(warnings, "Wrong %s: %s", path, strerror(errno));
 		return -1;
 	}
-	/* to get the kernel_id, we need to switch to that ns and examine
-	 * /proc/self */
-	err = netns_switch(entry);
-	if (err) {
-		label_add(warnings, "Wrong %s: %s", path, strerror(err));
+	kernel_id = netns_get_kernel_id_fd(entry->fd);
+	if (kernel_id < 0) {
+		label_add(warnings, "Wrong %s: %s", path, strerror(-kernel_id));
+		close(entry->fd);
+		free(entry);
 		return -1;
 	}
-	kernel_id = netns_get_kernel_id("/proc/self/ns/net");
-	if (kernel_id < 0)
-		return -kernel_id;
-	if (netns_check_duplicate(netns_list, kernel_id)) {
+	if (netns_check_duplicate(kernel_id)) {
 		close(entry->fd);
 		free(entry);
 		return -1;
@@ -127,59 +436,97 @@ static int netns_get_var_entry(struct netns_entry **result,
 	entry->name = strdup(name);
 	if (!entry->name)
 		return ENOMEM;
-	return netns_switch_root();
+	return 0;
 }
 
-static void netns_proc_entry_set_name(struct netns_entry *entry,
-				      const char *spid)
+static void netns_proc_entry_set_name(struct netns_entry *entry, const char *comm)
 {
-	char path[PATH_MAX], buf[PATH_MAX];
-	ssize_t len;
-	int commfd;
+	char buf[128];
 
-	snprintf(path, sizeof(path), "/proc/%s/comm", spid);
-	commfd = open(path, O_RDONLY);
-	len = -1;
-	if (commfd >= 0) {
-		len = read(commfd, path, sizeof(path));
-		if (len >= 0) {
-			path[sizeof(path) - 1] = '\0';
-			if (path[len - 1] == '\n')
-				path[len - 1] = '\0';
-		}
-		close(commfd);
-	}
-	if (len >= 0)
-		snprintf(buf, sizeof(buf), "PID %s (%s)", spid, path);
+	if (comm)
+		snprintf(buf, sizeof(buf), "PID %d (%s)", entry->pid, comm);
 	else
-		snprintf(buf, sizeof(buf), "PID %s", spid);
+		snprintf(buf, sizeof(buf), "PID %d", entry->pid);
 	entry->name = strdup(buf);
 	if (!entry->name)
 		entry->name = "?";
 }
 
+struct netns_comm {
+	struct netns_entry *entry;
+	char path[32];
+	char comm[64];
+};
+
+/* Called only once, after the /proc walk finished, so that only the comm
+ * file of the final (lowest) pid of each name space is read. The files
+ * are read in one batch. */
+static int netns_proc_set_names(struct list *netns_list, int procfd)
+{
+	struct batch_read *reqs;
+	struct netns_comm *comms;
+	struct netns_entry *entry;
+	unsigned int i, count = 0;
+
+	list_for_each(entry, *netns_list)
+		if (entry->pid && !entry->name)
+			count++;
+	if (!count)
+		return 0;
+	reqs = calloc(count, sizeof(*reqs));
+	comms = calloc(count, sizeof(*comms));
+	if (!reqs || !comms) {
+		free(reqs);
+		free(comms);
+		return ENOMEM;
+	}
+
+	i = 0;
+	list_for_each(entry, *netns_list) {
+		if (!entry->pid || entry->name)
+			continue;
+		comms[i].entry = entry;
+		snprintf(comms[i].path, sizeof(comms[i].path), "%d/comm", entry->pid);
+		reqs[i].dirfd = procfd;
+		reqs[i].path = comms[i].path;
+		reqs[i].buf = comms[i].comm;
+		reqs[i].size = sizeof(comms[i].comm);
+		i++;
+	}
+	batch_read(reqs, count);
+	for (i = 0; i < count; i++)
+		netns_proc_entry_set_name(comms[i].entry,
+					  reqs[i].res >= 0 ? comms[i].comm : NULL);
+
+	free(reqs);
+	free(comms);
+	return 0;
+}
+
 static int netns_get_proc_entry(struct netns_entry **result,
-				struct list *netns_list,
-				const char *spid)
+				int procfd, const char *spid)
 {
 	struct netns_entry *entry, *dup;
-	char path[PATH_MAX];
+	char path[32];
+	struct stat st;
 	pid_t pid;
 	long kernel_id;
 
-	snprintf(path, sizeof(path), "/proc/%s/ns/net", spid);
-	kernel_id = netns_get_kernel_id(path);
-	if (kernel_id < 0) {
+	snprintf(path, sizeof(path), "%s/ns/net", spid);
+	if (fstatat(procfd, path, &st, 0) < 0) {
 		/* ignore entries that cannot be read */
 		return -1;
 	}
+	kernel_id = netns_get_kernel_id(&st);
+	if (kernel_id < 0)
+		return -1;
 	pid = atol(spid);
-	dup = netns_check_duplicate(netns_list, kernel_id);
+	dup = netns_check_duplicate(kernel_id);
 	if (dup) {
-		if (dup->pid && (dup->pid > pid)) {
+		if (dup->pid && (dup->pid > pid))
 			dup->pid = pid;
-			netns_proc_entry_set_name(dup, spid);
-		}
+		if (filter_active())
+			filter_match_pid(dup, procfd, pid);
 		return -1;
 	}
 
@@ -189,35 +536,40 @@ static int netns_get_proc_entry(struct netns_entry **result,
 
 	entry->kernel_id = kernel_id;
 	entry->pid = pid;
-	entry->fd = open(path, O_RDONLY);
+	if (filter_active())
+		filter_match_pid(entry, procfd, pid);
+	/* Over the budget, the fd is opened only when needed. */
+	if (netns_fd_count >= netns_fd_budget)
+		return 0;
+	entry->fd = openat(procfd, path, O_RDONLY);
 	if (entry->fd < 0) {
 		/* ignore entries that cannot be read */
 		free(entry);
 		return -1;
 	}
-	netns_proc_entry_set_name(entry, spid);
 	return 0;
 }
 
 static int netns_new_list(struct list *result, int supported)
 {
 	struct netns_entry *root;
+	struct stat st;
 
 	root = netns_create();
 	if (!root)
 		return ENOMEM;
 	if (supported) {
-		root->kernel_id = netns_get_kernel_id("/proc/1/ns/net");
-		if (root->kernel_id < 0)
-			return -root->kernel_id;
 		root->fd = open("/proc/1/ns/net", O_RDONLY);
 		if (root->fd < 0)
 			return errno;
+		if (fstat(root->fd, &st) < 0)
+			return errno;
+		nsfs_dev = st.st_dev;
+		root->kernel_id = netns_get_kernel_id(&st);
 	}
 
 	list_init(result);
-	list_append(result, node(root));
-	return 0;
+	return netns_list_add(result, root);
 }
 
 static int netns_add_var_list(struct list *netns_list, struct list *warnings)
@@ -235,57 +587,69 @@ static int netns_add_var_list(struct list *netns_list, struct list *warnings)
 		if (!strcmp(de->d_name, ".") ||
 		    !strcmp(de->d_name, ".."))
 			continue;
-		err = netns_get_var_entry(&entry, netns_list, de->d_name, warnings);
+		err = netns_get_var_entry(&entry, de->d_name, warnings);
 		if (err < 0) {
 			/* duplicate entry */
 			continue;
 		}
+		if (!err)
+			err = netns_list_add(netns_list, entry);
 		if (err)
 			return err;
-		list_append(netns_list, node(entry));
 	}
 	closedir(dir);
 
 	return 0;
 }
 
-static int netns_add_proc_list(struct list *netns_list)
+static int netns_add_proc_pid(int procfd, const char *spid, void *arg)
 {
+	struct list *netns_list = arg;
 	struct netns_entry *entry;
-	struct dirent *de;
-	DIR *dir;
 	int err;
 
-	dir = opendir("/proc");
-	if (!dir)
+	err = netns_get_proc_entry(&entry, procfd, spid);
+	if (err < 0) {
+		/* duplicate entry */
 		return 0;
-
-	while ((de = readdir(dir)) != NULL) {
-		if (!strcmp(de->d_name, ".") ||
-		    !strcmp(de->d_name, ".."))
-			continue;
-		if (de->d_name[0] < '0' || de->d_name[0] > '9')
-			continue;
-		err = netns_get_proc_entry(&entry, netns_list, de->d_name);
-		if (err < 0) {
-			/* duplicate entry */
-			continue;
-		}
-		if (err)
-			return err;
-		list_append(netns_list, node(entry));
 	}
-	closedir(dir);
+	if (!err)
+		err = netns_list_add(netns_list, entry);
+	return err;
+}
 
-	return 0;
+static int netns_add_proc_list(struct list *netns_list)
+{
+	int procfd, err;
+
+	procfd = open("/proc", O_RDONLY | O_DIRECTORY);
+	if (procfd < 0)
+		return 0;
+	err = netns_proc_walk(procfd, netns_add_proc_pid, netns_list);
+	/* Now that the lowest pid of each name space is known, name them. */
+	if (!err)
+		err = netns_proc_set_names(netns_list, procfd);
+	close(procfd);
+	return err;
 }
 
+static const struct nla_policy netnsa_policy[NETNSA_MAX + 1] = {
+	[NETNSA_NSID]	= { .type = NLA_U32 },
+};
+
 /* Returns -1 if netnsids are not supported. */
 static int netns_get_id(struct nl_handle *hnd, struct netns_entry *entry)
 {
+	struct nlattr *tb[NETNSA_MAX + 1];
 	struct nlmsg *req, *resp;
-	int res = -1;
+	int res = -1, err;
 
+	/* The fd stays valid until the next netns call of this thread. */
+	pthread_mutex_lock(&netns_fd_lock);
+	err = netns_fd_get(entry);
+	pthread_mutex_unlock(&netns_fd_lock);
+	if (err)
+		return -1;
 	req = rtnlmsg_new(RTM_GETNSID, AF_UNSPEC, 0, sizeof(struct rtgenmsg));
 	if (!req)
 		return -1;
@@ -295,10 +659,58 @@ static int netns_get_id(struct nl_handle *hnd, struct netns_entry *entry)
 		goto out_req;
 	if (!nlmsg_get(resp, sizeof(struct rtgenmsg)))
 		goto out_resp;
-	for_each_nla(a, resp) {
-		if (a->nla_type == NETNSA_NSID) {
-			res = nla_read_s32(a);
-			break;
+	nlmsg_parse(resp, tb, NETNSA_MAX, netnsa_policy);
+	if (tb[NETNSA_NSID])
+		res = nla_read_s32(tb[NETNSA_NSID]);
+
+out_resp:
+	nlmsg_free(resp);
+out_req:
+	nlmsg_free(req);
+	return res;
+}
+
+static int netns_add_id(struct netns_entry *current, struct netns_entry *ns, int id)
+{
+	struct netns_id *nsid;
+	int err;
+
+	nsid = malloc(sizeof(*nsid));
+	if (!nsid)
+		return ENOMEM;
+	nsid->ns = ns;
+	nsid->id = id;
+	if ((err = hash_add(&current->ids, &nsid->h, id)))
+		free(nsid);
+	return err;
+}
+
+/* Fills current->ids with the netnsids assigned in the current name space,
+ * with ns not yet known. Returns the number of ids or -1 if dumping is not
+ * supported. */
+static int netns_dump_ids(struct nl_handle *hnd, struct netns_entry *current)
+{
+	struct nlattr *tb[NETNSA_MAX + 1];
+	struct nlmsg *req, *resp;
+	int res = -1, id;
+
+	req = rtnlmsg_new(RTM_GETNSID, AF_UNSPEC, NLM_F_DUMP, sizeof(struct rtgenmsg));
+	if (!req)
+		return -1;
+	if (nl_exchange(hnd, req, &resp))
+		goto out_req;
+	res = 0;
+	for_each_nlmsg(m, resp) {
+		if (!nlmsg_get(m, sizeof(struct rtgenmsg)))
+			continue;
+		nlmsg_parse(m, tb, NETNSA_MAX, netnsa_policy);
+		if (!tb[NETNSA_NSID])
+			continue;
+		id = nla_read_s32(tb[NETNSA_NSID]);
+		if (id >= 0 && !hash_find(&current->ids, id)) {
+			if (netns_add_id(current, NULL, id))
+				goto out_resp;
+			res++;
 		}
 	}
 
@@ -310,81 +722,299 @@ out_req:
 }
 
 /* This is best effort only, if anything fails (e.g. netnsids are not
- * supported by kernel), we fail back to heuristics. */
+ * supported by kernel), we fail back to heuristics.
+ *
+ * A single dump tells us which netnsids are assigned in the current name
+ * space. The dump cannot tell which name space an id refers to, thus we
+ * still have to ask for the ids of the individual name spaces, but we can
+ * stop as soon as all the assigned ids are resolved. Most name spaces
+ * have no or just a few ids assigned. */
 static void netns_get_all_ids(struct netns_entry *current, struct list *netns_list)
 {
-	struct nl_handle hnd;
+	struct nl_handle *hnd;
 	struct netns_entry *entry;
 	struct netns_id *nsid;
-	int id;
+	int count, id;
 
-	if (netns_switch(current))
+	if (!netns_supported)
 		return;
-	if (rtnl_open(&hnd) < 0)
+	if (netns_nl_get(current, NETLINK_ROUTE, &hnd))
 		return;
+	/* Keep the socket open while the fds of the others are used. */
+	netns_pin(current);
 
+	count = netns_dump_ids(hnd, current);
 	list_for_each(entry, *netns_list) {
-		id = netns_get_id(&hnd, entry);
+		if (!count)
+			break;
+		id = netns_get_id(hnd, entry);
+		stats_count("netnsid requests", 1);
 		if (id < 0)
 			continue;
-		nsid = malloc(sizeof(*nsid));
-		if (!nsid)
-			break;
-		nsid->ns = entry;
-		nsid->id = id;
-		list_append(&current->ids, node(nsid));
+		if (count < 0) {
+			/* no dump support, record everything */
+			if (netns_add_id(current, entry, id))
+				break;
+			continue;
+		}
+		nsid = hash_entry(hash_find(&current->ids, id), struct netns_id, h);
+		if (nsid && !nsid->ns) {
+			nsid->ns = entry;
+			count--;
+		}
 	}
-	nl_close(&hnd);
+	netns_unpin(current);
 }
 
-int netns_fill_list(struct list *result, int supported)
+/* No point in preparing sysfs if no handler reads it. */
+static int netns_need_sysfs(void)
 {
-	struct netns_entry *entry;
+	return handler_sources() & HANDLER_SYSFS;
+}
+
+static int netns_scan(struct netns_entry *entry)
+{
+	unsigned int inconsistent = nl_inconsistent_dumps();
 	int err;
 
-	err = netns_new_list(result, supported);
-	if (err)
+	netns_pin(entry);
+	if (netns_need_sysfs() && (err = sysfs_mount(entry->name)))
+		goto out_unpin;
+	prefetch_start(entry);
+	if ((err = if_list(&entry->ifaces, entry)))
+		goto out;
+	err = netns_handler_scan(entry);
+out:
+	inconsistent = nl_inconsistent_dumps() - inconsistent;
+	if (!err && inconsistent)
+		label_add(&entry->warnings, "%s: %u netlink dump(s) may be inconsistent",
+			  entry->name ? : "root netns", inconsistent);
+	prefetch_free(entry);
+	sysfs_umount();
+out_unpin:
+	netns_unpin(entry);
+	return err;
+}
+
+/* A name space that cannot be reopened has disappeared since the discovery.
+ * This is not fatal. */
+static int netns_vanished(struct netns_entry *entry, int err)
+{
+	if (err != ESTALE)
 		return err;
-	if (supported) {
-		struct netns_entry *root = list_head(*result);
+	label_add(&entry->warnings, "%s: name space disappeared",
+		  entry->name ? : "root netns");
+	return 0;
+}
 
-		err = netns_add_var_list(result, &root->warnings);
-		if (err)
-			return err;
-		err = netns_add_proc_list(result);
-		if (err)
-			return err;
+/* Stub entries not referenced by any scanned interface are not worth
+ * showing. They are kept aside until netns_list_free. */
+static DECLARE_LIST(netns_hidden);
+
+static void netns_hide_stubs(struct list *netns_list)
+{
+	struct netns_entry *entry, *next;
+
+	/* the root name space always stays first */
+	for (entry = node_next(list_head(*netns_list)); node_valid(entry); entry = next) {
+		next = node_next(entry);
+		if (entry->stub && list_empty(entry->ifaces)) {
+			node_remove(node(entry));
+			list_append(&netns_hidden, node(entry));
+		}
 	}
+}
+
+static int netns_scan_serial(struct list *netns_list)
+{
+	struct netns_entry *entry;
+	int err;
 
-	if ((err = sysfs_init()))
+	if (netns_need_sysfs() && (err = sysfs_init()))
 		return err;
 
-	list_for_each(entry, *result) {
+	list_for_each(entry, *netns_list) {
+		if (entry->stub || entry->scanned)
+			continue;
 		if (entry->name) {
 			/* Do not try to switch to the root netns, as we're
 			 * already there when processing the first entry,
 			 * and netns_switch fails hard if there's no netns
 			 * support available. */
-			if ((err = netns_switch(entry)))
-				return err;
+			if ((err = netns_switch(entry))) {
+				if ((err = netns_vanished(entry, err)))
+					return err;
+				continue;
+			}
 		}
-		if ((err = sysfs_mount(entry->name)))
-			return err;
-		if ((err = if_list(&entry->ifaces, entry)))
+		if ((err = netns_scan(entry)))
 			return err;
-		if ((err = netns_handler_scan(entry)))
+	}
+	return 0;
+}
+
+struct netns_workers {
+	pthread_mutex_t lock;
+	struct netns_entry *next;
+	int err;
+};
+
+static struct netns_entry *netns_worker_next(struct netns_workers *w)
+{
+	struct netns_entry *entry = NULL;
+
+	pthread_mutex_lock(&w->lock);
+	while (!w->err && node_valid(w->next)) {
+		entry = w->next;
+		w->next = node_next(entry);
+		if (!entry->stub && !entry->scanned)
+			break;
+		entry = NULL;
+	}
+	pthread_mutex_unlock(&w->lock);
+	return entry;
+}
+
+/* setns(CLONE_NEWNET) affects the calling thread only, thus every worker
+ * can switch name spaces freely. Each name space is scanned by exactly
+ * one worker, which fills its own ifaces list and warnings. */
+static void *netns_worker(void *arg)
+{
+	struct netns_workers *w = arg;
+	struct netns_entry *entry;
+	int err;
+
+	if (netns_need_sysfs() && (err = sysfs_init()))
+		goto out;
+	while ((entry = netns_worker_next(w))) {
+		/* Unlike the serial scan, always switch: the worker may
+		 * have been in another name space before. */
+		if ((err = netns_switch(entry))) {
+			if ((err = netns_vanished(entry, err)))
+				break;
+			continue;
+		}
+		if ((err = netns_scan(entry)))
+			break;
+	}
+	sysfs_clean();
+out:
+	if (err) {
+		pthread_mutex_lock(&w->lock);
+		if (!w->err)
+			w->err = err;
+		pthread_mutex_unlock(&w->lock);
+	}
+	return NULL;
+}
+
+static int netns_scan_parallel(struct list *netns_list)
+{
+	struct netns_workers w = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.next = list_head(*netns_list),
+		.err = 0,
+	};
+	pthread_t *threads;
+	int i, count, err;
+
+	threads = calloc(jobs, sizeof(*threads));
+	if (!threads)
+		return ENOMEM;
+	for (count = 0; count < jobs; count++) {
+		if ((err = pthread_create(&threads[count], NULL, netns_worker, &w)))
+			break;
+	}
+	if (!count) {
+		free(threads);
+		return err;
+	}
+	/* Running with fewer workers than requested is fine. */
+	for (i = 0; i < count; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	return w.err;
+}
+
+/* Scans all name spaces that are neither stubs nor scanned yet. */
+static int netns_scan_all(struct list *netns_list)
+{
+	struct netns_entry *entry;
+	struct stats_timer timer;
+	int err;
+
+	if (prefetch) {
+		stats_timer_start(&timer);
+		if ((err = prefetch_all(netns_list)))
 			return err;
-		sysfs_umount();
+		stats_timer_stop(&timer, "netlink prefetch");
 	}
+
+	stats_timer_start(&timer);
+	if (netns_supported && jobs > 1)
+		err = netns_scan_parallel(netns_list);
+	else
+		err = netns_scan_serial(netns_list);
+	if (err)
+		return err;
+	stats_timer_stop(&timer, "netns scan");
 	/* Walk all net name spaces again and gather all kernel assigned
 	 * netnsids. We don't assign netnsids ourselves to prevent assigning
 	 * them needlessly - the kernel assigns only those that are really
 	 * needed while doing netlinks dumps. Note also that netnsids are
-	 * per name space and this is O(n^2). */
-	list_for_each(entry, *result)
-		netns_get_all_ids(entry, result);
+	 * per name space; see netns_get_all_ids for how we avoid O(n^2). */
+	stats_timer_start(&timer);
+	list_for_each(entry, *netns_list) {
+		if (entry->stub || entry->scanned)
+			continue;
+		netns_get_all_ids(entry, netns_list);
+		entry->scanned = 1;
+	}
+	stats_timer_stop(&timer, "netnsid collection");
+	return 0;
+}
+
+int netns_fill_list(struct list *result, int supported)
+{
+	struct netns_entry *entry;
+	struct stats_timer timer;
+	int more, err;
+
+	netns_supported = supported;
+	netns_fd_init();
+	stats_timer_start(&timer);
+	err = netns_new_list(result, supported);
+	if (err)
+		return err;
+	if (supported) {
+		struct netns_entry *root = list_head(*result);
+
+		err = netns_add_var_list(result, &root->warnings);
+		if (err)
+			return err;
+		err = netns_add_proc_list(result);
+		if (err)
+			return err;
+	}
+	if (filter_active())
+		list_for_each(entry, *result)
+			entry->stub = !filter_selected(entry);
+	if (seed_active() && (err = seed_init(result)))
+		return err;
+	stats_timer_stop(&timer, "netns discovery");
+	stats_count("netns found", netns_index.count);
+
+	/* Without seeds, everything is scanned in one pass. With seeds,
+	 * the scan continues as long as new name spaces are reached. */
+	do {
+		if ((err = netns_scan_all(result)))
+			return err;
+		if ((err = seed_expand(result, &more)))
+			return err;
+	} while (more);
 	/* And finally, resolve netnsid+ifindex to the if_entry pointers. */
 	match_all_netnsid(result);
+	netns_hide_stubs(result);
 
 	if ((err = master_resolve(result)))
 		return err;
@@ -402,9 +1032,31 @@ static int do_netns_switch(int fd)
 	return 0;
 }
 
+/* The name space the current thread was switched to by netns_switch. */
+static __thread struct netns_entry *netns_current;
+
+/* Must be called with netns_fd_lock held. */
+static int __netns_switch(struct netns_entry *dest)
+{
+	int err;
+
+	if (dest == netns_current)
+		return 0;
+	if ((err = netns_fd_get(dest)))
+		return err;
+	err = do_netns_switch(dest->fd);
+	netns_current = err ? NULL : dest;
+	return err;
+}
+
 int netns_switch(struct netns_entry *dest)
 {
-	return do_netns_switch(dest->fd);
+	int err;
+
+	pthread_mutex_lock(&netns_fd_lock);
+	err = __netns_switch(dest);
+	pthread_mutex_unlock(&netns_fd_lock);
+	return err;
 }
 
 /* Used also to detect whether netns support is available.
@@ -423,15 +1075,65 @@ int netns_switch_root(void)
 	}
 	res = do_netns_switch(fd);
 	close(fd);
+	netns_current = NULL;
 	if (res == ENOENT)
 		return -1;
 	return res;
 }
 
+int netns_nl_get(struct netns_entry *ns, int family, struct nl_handle **hnd)
+{
+	struct nl_handle **cache;
+	int err = 0;
+
+	pthread_mutex_lock(&netns_fd_lock);
+	cache = family == NETLINK_GENERIC ? &ns->genl : &ns->rtnl;
+	if (*cache)
+		goto out_touch;
+
+	ns->pinned++;
+	/* Without netns support, there is only the root name space and we
+	 * are in it. */
+	if (netns_supported && (err = __netns_switch(ns)))
+		goto out_unpin;
+	/* The lock might have been dropped by the switch. */
+	if (*cache) {
+		ns->pinned--;
+		goto out_touch;
+	}
+	netns_fd_reserve(1);
+	*cache = malloc(sizeof(**cache));
+	if (!*cache) {
+		err = ENOMEM;
+		goto out_unpin;
+	}
+	if ((err = nl_open(*cache, family))) {
+		free(*cache);
+		*cache = NULL;
+		err = -err;
+		goto out_unpin;
+	}
+	netns_fd_count++;
+	ns->pinned--;
+
+out_touch:
+	netns_lru_touch(ns);
+	*hnd = *cache;
+	pthread_mutex_unlock(&netns_fd_lock);
+	return 0;
+
+out_unpin:
+	ns->pinned--;
+	pthread_mutex_unlock(&netns_fd_lock);
+	return err;
+}
+
 static void netns_list_destruct(struct netns_entry *entry)
 {
 	netns_handler_cleanup(entry);
-	list_free(&entry->ids, NULL);
+	hash_free_all(&entry->ids, NULL);
+	prefetch_free(entry);
+	netns_fd_close(entry);
 	if_list_free(&entry->ifaces);
 	free(entry->name);
 }
@@ -439,4 +1141,6 @@ static void netns_list_destruct(struct netns_entry *entry)
 void netns_list_free(struct list *netns_list)
 {
 	list_free(netns_list, (destruct_f)netns_list_destruct);
+	list_free(&netns_hidden, (destruct_f)netns_list_destruct);
+	hash_free(&netns_index);
 }
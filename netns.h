@@ -17,21 +17,25 @@
 #define _NETNS_H
 
 #include <sys/types.h>
+#include "hash.h"
 #include "if.h"
 #include "list.h"
+#include "prefetch.h"
 
 struct label;
 struct netns_entry;
+struct nl_handle;
 struct route;
 
 struct netns_id {
-	struct node n;
+	struct hnode h;			/* in netns_entry->ids, keyed by id */
 	struct netns_entry *ns;
 	int id;
 };
 
 struct netns_entry {
 	struct node n;
+	struct hnode hash_node;		/* in the kernel_id index */
 	struct list ifaces;
 	struct list warnings;
 	long kernel_id;
@@ -40,13 +44,38 @@ struct netns_entry {
 	char *name;
 	pid_t pid;
 	int fd;
-	struct list ids;
+	struct hash ids;
 	struct list rtables;
+	struct prefetch prefetch;
+	/* cached netlink sockets, see netns_nl_get */
+	struct nl_handle *rtnl;
+	struct nl_handle *genl;
+	/* the fd and the sockets may be closed when not pinned, see
+	 * netns_fd_reserve */
+	struct netns_entry *lru_prev, *lru_next;
+	int pinned;
+	/* see filter.h; stub entries are not scanned */
+	unsigned int filter;
+	int stub;
+	/* interfaces and netnsids are filled in */
+	int scanned;
 };
 
+void netns_register(void);
 int netns_fill_list(struct list *result, int supported);
 void netns_list_free(struct list *list);
 int netns_switch(struct netns_entry *dest);
 int netns_switch_root(void);
 
+/* Returns the netlink socket of the given family (NETLINK_ROUTE or
+ * NETLINK_GENERIC) living in the name space. The socket is created on the
+ * first use, which may switch the current thread to the name space, and
+ * is owned by the netns entry. Only one thread may use the entry at a time.
+ * Unless the entry is pinned, the socket is valid only until the next netns
+ * call of the thread. */
+int netns_nl_get(struct netns_entry *ns, int family, struct nl_handle **hnd);
+/* Prevents the fd and the sockets of the entry from being closed. */
+void netns_pin(struct netns_entry *ns);
+void netns_unpin(struct netns_entry *ns);
+
 #endif
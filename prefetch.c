@@ -0,0 +1,389 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "prefetch.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "dump.h"
+#include "list.h"
+#include "netlink.h"
+#include "netns.h"
+#include "stats.h"
+
+/* Maximum number of sockets open at the same time. */
+#define PREFETCH_WINDOW		256
+#define PREFETCH_EVENTS		64
+#define PREFETCH_TIMEOUT_MS	500
+
+struct prefetch_conn {
+	struct nl_handle hnd;
+	struct netns_entry *ns;
+	int dump;
+	int attempt;
+	/* when to send the interrupted dump again, in us; 0 if not waiting */
+	long long restart_at;
+	struct stats_timer timer;
+	struct nlmsg *resp, *tail;
+};
+
+struct prefetch_ctx {
+	int epfd;
+	struct nlmsg *req[PREFETCH_MAX];
+	struct prefetch_conn *free_conns[PREFETCH_WINDOW];
+	int free_count;
+	/* connections waiting for a restart */
+	int waiting;
+};
+
+static long long prefetch_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/* Do not use more than a quarter of the allowed descriptors, the netns
+ * entries hold some, too. */
+static int prefetch_window(void)
+{
+	struct rlimit rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl) < 0 || rl.rlim_cur == RLIM_INFINITY ||
+	    rl.rlim_cur / 4 >= PREFETCH_WINDOW)
+		return PREFETCH_WINDOW;
+	return rl.rlim_cur / 4 ? rl.rlim_cur / 4 : 1;
+}
+
+static struct nlmsg *prefetch_req_new(int dump)
+{
+	const unsigned int *tables;
+
+	switch (dump) {
+	case PREFETCH_LINK:
+		return rtnl_link_dump_req();
+	case PREFETCH_ADDR:
+		return dump_addr_req();
+	case PREFETCH_ROUTE:
+		/* the first selected table; route_scan dumps the others */
+		return dump_route_req(dump_route_tables(&tables) ? tables[0] :
+							     RT_TABLE_UNSPEC);
+	}
+	return NULL;
+}
+
+static int prefetch_req_init(struct nlmsg **req)
+{
+	int i;
+
+	for (i = 0; i < PREFETCH_MAX; i++)
+		if (!(req[i] = prefetch_req_new(i)))
+			return ENOMEM;
+	return 0;
+}
+
+static void prefetch_conn_close(struct prefetch_ctx *ctx, struct prefetch_conn *conn)
+{
+	epoll_ctl(ctx->epfd, EPOLL_CTL_DEL, conn->hnd.fd, NULL);
+	nl_close(&conn->hnd);
+	nlmsg_free(conn->resp);
+	conn->resp = conn->tail = NULL;
+	conn->ns = NULL;
+	if (conn->restart_at) {
+		conn->restart_at = 0;
+		ctx->waiting--;
+	}
+	ctx->free_conns[ctx->free_count++] = conn;
+}
+
+static void prefetch_conn_stats(struct prefetch_ctx *ctx, struct prefetch_conn *conn,
+				const char **time, const char **restarts)
+{
+	nl_dump_stats(&conn->hnd, nlmsg_get_hdr(ctx->req[conn->dump])->nlmsg_type,
+		      time, restarts);
+}
+
+/* Returns 1 if the connection should stay open, 0 if it was closed. */
+static int prefetch_conn_send(struct prefetch_ctx *ctx, struct prefetch_conn *conn)
+{
+	if (!conn->attempt)
+		stats_timer_start(&conn->timer);
+	if (nl_dump_start(&conn->hnd, ctx->req[conn->dump])) {
+		prefetch_conn_close(ctx, conn);
+		return 0;
+	}
+	return 1;
+}
+
+/* Sends the dumps whose restart is due. Returns the number of closed
+ * connections. Sets *timeout_ms to the time until the next restart if it
+ * is sooner. */
+static int prefetch_restart(struct prefetch_ctx *ctx, struct prefetch_conn *conns,
+			    int *timeout_ms)
+{
+	long long now, wait;
+	int i, closed = 0;
+
+	if (!ctx->waiting)
+		return 0;
+	now = prefetch_now();
+	for (i = 0; i < PREFETCH_WINDOW; i++) {
+		if (!conns[i].restart_at)
+			continue;
+		wait = conns[i].restart_at - now;
+		if (wait > 0) {
+			if ((wait + 999) / 1000 < *timeout_ms)
+				*timeout_ms = (wait + 999) / 1000;
+			continue;
+		}
+		conns[i].restart_at = 0;
+		ctx->waiting--;
+		closed += !prefetch_conn_send(ctx, &conns[i]);
+	}
+	return closed;
+}
+
+static int prefetch_conn_open(struct prefetch_ctx *ctx, struct netns_entry *ns)
+{
+	struct prefetch_conn *conn;
+	struct epoll_event ev;
+
+	/* The socket stays bound to the name space it was created in. */
+	if (ns->name && netns_switch(ns))
+		return 0;
+	conn = ctx->free_conns[--ctx->free_count];
+	if (rtnl_open(&conn->hnd) < 0)
+		goto err_conn;
+	conn->ns = ns;
+	conn->dump = 0;
+	conn->attempt = 0;
+	conn->restart_at = 0;
+	conn->resp = conn->tail = NULL;
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = conn;
+	if (epoll_ctl(ctx->epfd, EPOLL_CTL_ADD, conn->hnd.fd, &ev) < 0) {
+		nl_close(&conn->hnd);
+		goto err_conn;
+	}
+	return prefetch_conn_send(ctx, conn);
+
+err_conn:
+	ctx->free_conns[ctx->free_count++] = conn;
+	return 0;
+}
+
+/* Returns 1 if the connection should stay open, 0 if it was closed. */
+static int prefetch_conn_recv(struct prefetch_ctx *ctx, struct prefetch_conn *conn)
+{
+	struct prefetch *pf = &conn->ns->prefetch;
+	const char *time_name, *restarts_name;
+	int err;
+
+	err = nl_dump_recv(&conn->hnd, &conn->resp, &conn->tail);
+	if (err == EAGAIN)
+		return 1;
+	prefetch_conn_stats(ctx, conn, &time_name, &restarts_name);
+	if (err == EINTR && conn->attempt < nl_dump_retries()) {
+		/* Like nl_request, restart after a backoff. The socket
+		 * stays quiet until then. */
+		nlmsg_free(conn->resp);
+		conn->resp = conn->tail = NULL;
+		stats_count(restarts_name, 1);
+		conn->restart_at = prefetch_now() +
+				   nl_backoff_us(&conn->hnd, conn->attempt);
+		conn->attempt++;
+		ctx->waiting++;
+		return 1;
+	}
+	if (err == EINTR && nl_dump_inconsistent_ok()) {
+		pf->inconsistent |= 1 << conn->dump;
+		err = 0;
+	}
+	if (err) {
+		prefetch_conn_close(ctx, conn);
+		return 0;
+	}
+
+	pf->msg[conn->dump] = conn->resp;
+	pf->valid |= 1 << conn->dump;
+	stats_timer_stop(&conn->timer, time_name);
+	stats_count("netlink dumps prefetched", 1);
+	conn->resp = conn->tail = NULL;
+	conn->attempt = 0;
+	if (++conn->dump == PREFETCH_MAX) {
+		prefetch_conn_close(ctx, conn);
+		return 0;
+	}
+	return prefetch_conn_send(ctx, conn);
+}
+
+int prefetch_all(struct list *netns_list)
+{
+	struct prefetch_conn *conns;
+	struct prefetch_ctx ctx = { .req = { NULL } };
+	struct epoll_event events[PREFETCH_EVENTS];
+	struct netns_entry *next;
+	int active = 0;
+	int i, n, timeout, err = 0;
+
+	ctx.epfd = epoll_create1(0);
+	if (ctx.epfd < 0)
+		return 0;
+	conns = calloc(PREFETCH_WINDOW, sizeof(*conns));
+	if (!conns) {
+		err = ENOMEM;
+		goto out_epoll;
+	}
+	ctx.free_count = prefetch_window();
+	for (i = 0; i < ctx.free_count; i++)
+		ctx.free_conns[i] = &conns[i];
+	if ((err = prefetch_req_init(ctx.req)))
+		goto out_req;
+
+	next = list_head(*netns_list);
+	while (1) {
+		while (ctx.free_count && node_valid(next)) {
+			if (!next->stub && !next->scanned)
+				active += prefetch_conn_open(&ctx, next);
+			next = node_next(next);
+		}
+		if (!active)
+			break;
+
+		timeout = PREFETCH_TIMEOUT_MS;
+		active -= prefetch_restart(&ctx, conns, &timeout);
+		n = epoll_wait(ctx.epfd, events, PREFETCH_EVENTS, timeout);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 || (!n && !ctx.waiting)) {
+			/* Nothing is coming. Give up on the pending name
+			 * spaces, they will be dumped synchronously. */
+			for (i = 0; i < PREFETCH_WINDOW; i++)
+				if (conns[i].ns)
+					prefetch_conn_close(&ctx, &conns[i]);
+			break;
+		}
+		for (i = 0; i < n; i++)
+			if (!prefetch_conn_recv(&ctx, events[i].data.ptr))
+				active--;
+	}
+
+out_req:
+	for (i = 0; i < PREFETCH_MAX; i++)
+		nlmsg_free(ctx.req[i]);
+	free(conns);
+out_epoll:
+	close(ctx.epfd);
+	netns_switch_root();
+	return err;
+}
+
+void prefetch_start(struct netns_entry *ns)
+{
+	struct prefetch *pf = &ns->prefetch;
+	int i;
+
+	for (i = 0; i < PREFETCH_MAX; i++) {
+		if ((pf->valid | pf->pending) & (1 << i))
+			continue;
+		pf->req[i] = prefetch_req_new(i);
+		if (!pf->req[i])
+			break;
+		if (rtnl_open(&pf->hnd[i]) < 0)
+			goto err_req;
+		if (nl_dump_start(&pf->hnd[i], pf->req[i]))
+			goto err_hnd;
+		pf->pending |= 1 << i;
+		stats_count("netlink dumps pipelined", 1);
+		continue;
+
+err_hnd:
+		nl_close(&pf->hnd[i]);
+err_req:
+		nlmsg_free(pf->req[i]);
+		pf->req[i] = NULL;
+	}
+}
+
+static void prefetch_finish(struct prefetch *pf, int dump)
+{
+	nl_close(&pf->hnd[dump]);
+	nlmsg_free(pf->req[dump]);
+	pf->req[dump] = NULL;
+	pf->pending &= ~(1 << dump);
+}
+
+int prefetch_get(struct netns_entry *ns, int dump, struct nlmsg **dest)
+{
+	struct prefetch *pf = &ns->prefetch;
+	int err;
+
+	if (pf->pending & (1 << dump)) {
+		err = nl_dump_finish(&pf->hnd[dump], pf->req[dump], dest);
+		prefetch_finish(pf, dump);
+		return err;
+	}
+	if (!(pf->valid & (1 << dump)))
+		return ENOENT;
+	*dest = pf->msg[dump];
+	pf->msg[dump] = NULL;
+	pf->valid &= ~(1 << dump);
+	if (pf->inconsistent & (1 << dump)) {
+		pf->inconsistent &= ~(1 << dump);
+		nl_inconsistent_dump();
+	}
+	return 0;
+}
+
+int prefetch_dump(struct netns_entry *ns, int dump, nl_dump_cb cb, void *ctx)
+{
+	struct prefetch *pf = &ns->prefetch;
+	struct nlmsg *msg;
+	int err = 0;
+
+	if (pf->pending & (1 << dump)) {
+		err = nl_dump_finish_cb(&pf->hnd[dump], pf->req[dump], cb, ctx);
+		prefetch_finish(pf, dump);
+		return err;
+	}
+	if (prefetch_get(ns, dump, &msg))
+		return -1;
+	for_each_nlmsg(m, msg)
+		if ((err = cb(m, ctx)))
+			break;
+	nlmsg_free(msg);
+	return err;
+}
+
+void prefetch_free(struct netns_entry *ns)
+{
+	struct prefetch *pf = &ns->prefetch;
+	int i;
+
+	for (i = 0; i < PREFETCH_MAX; i++) {
+		if (pf->pending & (1 << i))
+			prefetch_finish(pf, i);
+		nlmsg_free(pf->msg[i]);
+		pf->msg[i] = NULL;
+	}
+	pf->valid = 0;
+	pf->inconsistent = 0;
+}
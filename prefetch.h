@@ -0,0 +1,76 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _PREFETCH_H
+#define _PREFETCH_H
+
+#include "list.h"
+#include "netlink.h"
+
+struct netns_entry;
+
+enum {
+	PREFETCH_LINK,
+	PREFETCH_ADDR,
+	PREFETCH_ROUTE,
+	PREFETCH_MAX,
+};
+
+/* Embedded in struct netns_entry. */
+struct prefetch {
+	struct nlmsg *msg[PREFETCH_MAX];
+	unsigned int valid;
+	/* prefetched dumps accepted by --inconsistent-ok */
+	unsigned int inconsistent;
+	/* dumps in flight, see prefetch_start */
+	struct nl_handle hnd[PREFETCH_MAX];
+	struct nlmsg *req[PREFETCH_MAX];
+	unsigned int pending;
+};
+
+/*
+ * Opens a rtnetlink socket in every name space, issues the link, address
+ * and route dumps in all of them at once and collects the replies. Name
+ * spaces for which this fails are simply left out; the consumers fall
+ * back to dumping on their own. Returns 0 or a fatal error (ENOMEM).
+ */
+int prefetch_all(struct list *netns_list);
+
+/*
+ * Issues the dumps of the name space that were not prefetched, each on its
+ * own socket, so that all of them are in flight while the first one is
+ * being processed. Must be called from within the name space. Failures
+ * are not fatal, the consumers fall back to dumping on their own.
+ */
+void prefetch_start(struct netns_entry *ns);
+
+/*
+ * Passes the ownership of the prefetched dump to the caller, waiting for
+ * it if it is in flight. Returns ENOENT if the dump is not available or
+ * another error if it failed. Note that *dest may be NULL for an empty
+ * dump.
+ */
+int prefetch_get(struct netns_entry *ns, int dump, struct nlmsg **dest);
+
+/*
+ * Like prefetch_get but passes the messages to cb, see nl_dump. A dump in
+ * flight is parsed as it arrives. Returns -1 if the dump is not available.
+ */
+int prefetch_dump(struct netns_entry *ns, int dump, nl_dump_cb cb, void *ctx);
+
+/* Frees the unused dumps and closes the sockets. */
+void prefetch_free(struct netns_entry *ns);
+
+#endif
@@ -33,13 +33,13 @@ struct route {
 	struct if_entry *iif, *oif;
 	struct list metrics;
 	struct addr dst, gw, prefsrc, src;
-	unsigned int iifindex, oifindex, priority;
-	unsigned char table_id, tos, protocol, type, family, scope;
+	unsigned int iifindex, oifindex, priority, table_id;
+	unsigned char tos, protocol, type, family, scope;
 };
 
 struct rtable {
 	struct node n;
-	int id;
+	unsigned int id;
 	struct list routes;
 };
 
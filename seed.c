@@ -0,0 +1,374 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "seed.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "args.h"
+#include "filter.h"
+#include "handler.h"
+#include "hash.h"
+#include "if.h"
+#include "label.h"
+#include "list.h"
+#include "match.h"
+#include "netns.h"
+#include "tunnel.h"
+#include "utils.h"
+
+/* An interface to be reached once its name space is scanned. Either
+ * ifname (for the seeds given by the user) or ifindex is set. */
+struct seed {
+	struct node n;
+	char *spec;
+	struct netns_entry *ns;
+	char *ifname;
+	unsigned int ifindex;
+};
+
+/* Interfaces reached so far, keyed by the if_entry pointer. */
+struct seed_reached {
+	struct hnode h;
+};
+
+static DECLARE_LIST(pending);
+static struct hash reached = HASH_INITIALIZER;
+static int active;
+
+static int add_seed(char *arg)
+{
+	struct seed *s;
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return ENOMEM;
+	s->spec = arg;
+	list_append(&pending, node(s));
+	active = 1;
+	return 0;
+}
+
+static struct arg_option options[] = {
+	{ .long_name = "seed", .short_name = 's', .has_arg = 1,
+	  .type = ARG_CALLBACK, .action.callback = add_seed,
+	  .help = "scan only what is connected to the given interface (NETNS/IFNAME)",
+	},
+};
+
+void seed_register(void)
+{
+	arg_register_batch(options, ARRAY_SIZE(options));
+}
+
+static void seed_destruct(struct seed *s)
+{
+	free(s->ifname);
+}
+
+void seed_cleanup(void)
+{
+	list_free(&pending, (destruct_f)seed_destruct);
+	hash_free_all(&reached, NULL);
+}
+
+int seed_active(void)
+{
+	return active;
+}
+
+static int is_reached(struct if_entry *entry)
+{
+	return hash_find(&reached, (unsigned long)entry) != NULL;
+}
+
+/* Returns 1 if the interface was newly reached, 0 if not, or -errno. */
+static int mark_reached(struct if_entry *entry)
+{
+	struct seed_reached *r;
+
+	if (!entry || is_reached(entry))
+		return 0;
+	r = malloc(sizeof(*r));
+	if (!r)
+		return -ENOMEM;
+	if (hash_add(&reached, &r->h, (unsigned long)entry)) {
+		free(r);
+		return -ENOMEM;
+	}
+	return 1;
+}
+
+/* NETNS/IFNAME, the name space part is the name shown in the output and is
+ * empty for the root name space. IFNAME alone means the root name space. */
+static int seed_parse(struct seed *s, struct list *netns_list)
+{
+	struct netns_entry *ns;
+	char *slash;
+	size_t len;
+
+	slash = strrchr(s->spec, '/');
+	s->ifname = strdup(slash ? slash + 1 : s->spec);
+	if (!s->ifname)
+		return ENOMEM;
+	len = slash ? (size_t)(slash - s->spec) : 0;
+	list_for_each(ns, *netns_list) {
+		if (!len && !ns->name)
+			break;
+		if (len && ns->name && strlen(ns->name) == len &&
+		    !strncmp(ns->name, s->spec, len))
+			break;
+	}
+	if (!node_valid(ns) || !*s->ifname) {
+		fprintf(stderr, "Seed interface not found: %s\n", s->spec);
+		return ENOENT;
+	}
+	s->ns = ns;
+	return 0;
+}
+
+int seed_init(struct list *netns_list)
+{
+	struct netns_entry *ns;
+	struct seed *s;
+	int err;
+
+	list_for_each(ns, *netns_list)
+		ns->stub = 1;
+	list_for_each(s, pending) {
+		if ((err = seed_parse(s, netns_list)))
+			return err;
+		/* The seeds are scanned even if filtered out. */
+		s->ns->stub = 0;
+	}
+	return 0;
+}
+
+/* Schedules the interface ifindex (or just the name space if zero) to be
+ * reached. Returns 1 if anything changed, 0 if not, or -errno. */
+static int seed_add(struct netns_entry *ns, unsigned int ifindex, int *more)
+{
+	struct if_entry *entry;
+	struct seed *s;
+
+	if (!ns)
+		return 0;
+	if (ns->scanned) {
+		list_for_each(entry, ns->ifaces)
+			if (entry->if_index == ifindex)
+				return mark_reached(entry);
+		return 0;
+	}
+	if (ns->stub) {
+		if (!filter_allowed(ns))
+			return 0;
+		ns->stub = 0;
+		*more = 1;
+	}
+	if (!ifindex)
+		return 0;
+	list_for_each(s, pending)
+		if (s->ns == ns && s->ifindex == ifindex)
+			return 0;
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return -ENOMEM;
+	s->ns = ns;
+	s->ifindex = ifindex;
+	list_append(&pending, node(s));
+	return 0;
+}
+
+static int seed_resolve_pending(void)
+{
+	struct seed *s, *next;
+	struct if_entry *entry;
+	int res;
+
+	for (s = list_head(pending); node_valid(s); s = next) {
+		next = node_next(s);
+		if (!s->ns->scanned)
+			continue;
+		list_for_each(entry, s->ns->ifaces) {
+			if (s->ifname ? !strcmp(entry->if_name, s->ifname) :
+					entry->if_index == s->ifindex)
+				break;
+		}
+		if (node_valid(entry)) {
+			if ((res = mark_reached(entry)) < 0)
+				return -res;
+		} else if (s->ifname) {
+			label_add(&s->ns->warnings, "Seed interface not found: %s", s->spec);
+		}
+		node_remove(node(s));
+		seed_destruct(s);
+		free(s);
+	}
+	return 0;
+}
+
+static int cmp_ifindex(const void *a, const void *b)
+{
+	unsigned int ia = (*(struct if_entry **)a)->if_index;
+	unsigned int ib = (*(struct if_entry **)b)->if_index;
+
+	return ia < ib ? -1 : ia > ib;
+}
+
+static struct if_entry *find_ifindex(struct if_entry **ifaces, int count,
+				     unsigned int ifindex)
+{
+	struct if_entry key = { .if_index = ifindex }, *pkey = &key, **res;
+
+	if (!ifindex)
+		return NULL;
+	res = bsearch(&pkey, ifaces, count, sizeof(*ifaces), cmp_ifindex);
+	return res ? *res : NULL;
+}
+
+/* Reachability inside the name space does not depend on the direction of
+ * the relation: slaves reach their master and vice versa, the same for
+ * lower and upper devices. Returns the number of newly reached interfaces
+ * or -errno. */
+static int seed_walk_ns(struct netns_entry *ns)
+{
+	struct if_entry **ifaces, *entry, *other[3];
+	int i, j, count = 0, res, total = 0, changed;
+
+	list_for_each(entry, ns->ifaces)
+		count++;
+	if (!count)
+		return 0;
+	ifaces = malloc(count * sizeof(*ifaces));
+	if (!ifaces)
+		return -ENOMEM;
+	i = 0;
+	list_for_each(entry, ns->ifaces)
+		ifaces[i++] = entry;
+	qsort(ifaces, count, sizeof(*ifaces), cmp_ifindex);
+
+	do {
+		changed = 0;
+		for (i = 0; i < count; i++) {
+			entry = ifaces[i];
+			other[0] = find_ifindex(ifaces, count, entry->master_index);
+			other[1] = entry->link_netnsid < 0 ?
+				   find_ifindex(ifaces, count, entry->link_index) : NULL;
+			other[2] = entry->peer_netnsid < 0 ?
+				   find_ifindex(ifaces, count, entry->peer_index) : NULL;
+			for (j = 0; j < 3; j++) {
+				if (!other[j] || is_reached(entry) == is_reached(other[j]))
+					continue;
+				res = mark_reached(is_reached(entry) ? other[j] : entry);
+				if (res < 0)
+					goto out;
+				total += res;
+				changed = 1;
+			}
+		}
+	} while (changed);
+	res = total;
+out:
+	free(ifaces);
+	return res;
+}
+
+/* A tunnel and the interface holding its local address reach each other,
+ * looked up the same way as the handlers' post callbacks do. The underlay
+ * name space is brought in by seed_walk_netnsid; until it is scanned, the
+ * tunnel is skipped here. Returns the number of newly reached interfaces
+ * or -errno. */
+static int seed_walk_tunnels(struct netns_entry *ns)
+{
+	struct if_entry *entry, *under;
+	struct netns_entry *link_ns;
+	struct addr *local;
+	int res, total = 0;
+
+	list_for_each(entry, ns->ifaces) {
+		local = if_handler_tunnel_local(entry);
+		if (!local)
+			continue;
+		link_ns = entry->link_netnsid >= 0 ?
+			  match_netnsid(entry->link_netnsid, ns) : ns;
+		if (!link_ns || !link_ns->scanned)
+			continue;
+		under = tunnel_find_addr(link_ns, local);
+		if (!under || is_reached(entry) == is_reached(under))
+			continue;
+		res = mark_reached(is_reached(entry) ? under : entry);
+		if (res < 0)
+			return res;
+		total += res;
+	}
+	return total;
+}
+
+/* Follows the relations crossing name spaces. */
+static int seed_walk_netnsid(struct netns_entry *ns, int *more)
+{
+	struct if_entry *entry;
+	int res, total = 0;
+
+	list_for_each(entry, ns->ifaces) {
+		if (!is_reached(entry))
+			continue;
+		if (entry->link_netnsid >= 0) {
+			res = seed_add(match_netnsid(entry->link_netnsid, ns),
+				       entry->link_index, more);
+			if (res < 0)
+				return res;
+			total += res;
+		}
+		if (entry->peer_netnsid >= 0) {
+			res = seed_add(match_netnsid(entry->peer_netnsid, ns),
+				       entry->peer_index, more);
+			if (res < 0)
+				return res;
+			total += res;
+		}
+	}
+	return total;
+}
+
+int seed_expand(struct list *netns_list, int *more)
+{
+	struct netns_entry *ns;
+	int err, res, changed;
+
+	*more = 0;
+	if (!active)
+		return 0;
+	if ((err = seed_resolve_pending()))
+		return err;
+	do {
+		changed = 0;
+		list_for_each(ns, *netns_list) {
+			if (!ns->scanned)
+				continue;
+			if ((res = seed_walk_ns(ns)) < 0)
+				return -res;
+			changed += res;
+			if ((res = seed_walk_tunnels(ns)) < 0)
+				return -res;
+			changed += res;
+			if ((res = seed_walk_netnsid(ns, more)) < 0)
+				return -res;
+			changed += res;
+		}
+	} while (changed);
+	return 0;
+}
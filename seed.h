@@ -0,0 +1,33 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _SEED_H
+#define _SEED_H
+
+#include "list.h"
+
+void seed_register(void);
+void seed_cleanup(void);
+
+/* Returns nonzero if any --seed was given. */
+int seed_active(void);
+/* Turns all name spaces except those of the seeds into stubs. */
+int seed_init(struct list *netns_list);
+/* To be called after the non-stub name spaces were scanned. Follows the
+ * interfaces connected to the seeds and unstubs the name spaces they lead
+ * to. *more is set if there are new name spaces to scan. */
+int seed_expand(struct list *netns_list, int *more);
+
+#endif
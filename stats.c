@@ -0,0 +1,132 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "stats.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "args.h"
+#include "list.h"
+#include "utils.h"
+
+struct stats_entry {
+	struct node n;
+	const char *name;
+	unsigned long count;
+	unsigned long long nsec;
+};
+
+static int enabled;
+static DECLARE_LIST(counters);
+static pthread_mutex_t counters_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int set_enabled(_unused char *arg)
+{
+	enabled = 1;
+	return 0;
+}
+
+static struct arg_option options[] = {
+	{ .long_name = "stats", .short_name = '\0', .has_arg = 0,
+	  .type = ARG_CALLBACK, .action.callback = set_enabled,
+	  .help = "print timing statistics to stderr",
+	},
+};
+
+void stats_register(void)
+{
+	arg_register_batch(options, ARRAY_SIZE(options));
+}
+
+int stats_enabled(void)
+{
+	return enabled;
+}
+
+static struct stats_entry *stats_get(const char *name)
+{
+	struct stats_entry *entry;
+
+	list_for_each(entry, counters)
+		if (!strcmp(entry->name, name))
+			return entry;
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return NULL;
+	entry->name = name;
+	list_append(&counters, node(entry));
+	return entry;
+}
+
+static void stats_add(const char *name, unsigned long n, unsigned long long nsec)
+{
+	struct stats_entry *entry;
+
+	if (!enabled)
+		return;
+	pthread_mutex_lock(&counters_lock);
+	entry = stats_get(name);
+	if (entry) {
+		entry->count += n;
+		entry->nsec += nsec;
+	}
+	pthread_mutex_unlock(&counters_lock);
+}
+
+void stats_timer_start(struct stats_timer *t)
+{
+	clock_gettime(CLOCK_MONOTONIC, &t->start);
+}
+
+void stats_timer_stop(struct stats_timer *t, const char *name)
+{
+	struct timespec now;
+	long long nsec;
+
+	if (!enabled)
+		return;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	nsec = (now.tv_sec - t->start.tv_sec) * 1000000000LL +
+	       (now.tv_nsec - t->start.tv_nsec);
+	stats_add(name, 1, nsec > 0 ? nsec : 0);
+}
+
+void stats_count(const char *name, unsigned long n)
+{
+	stats_add(name, n, 0);
+}
+
+void stats_print(void)
+{
+	struct stats_entry *entry;
+
+	if (!enabled)
+		return;
+	list_for_each(entry, counters) {
+		if (entry->nsec)
+			fprintf(stderr, "%-32s %10lu %12.3f ms\n", entry->name,
+				entry->count, entry->nsec / 1000000.0);
+		else
+			fprintf(stderr, "%-32s %10lu\n", entry->name, entry->count);
+	}
+}
+
+void stats_cleanup(void)
+{
+	list_free(&counters, NULL);
+}
@@ -0,0 +1,42 @@
+/*
+ * This file is a part of plotnetcfg, a tool to visualize network config.
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <time.h>
+
+/*
+ * Run time statistics, printed to stderr when requested by --stats.
+ * Counters are identified by name; the name must be a string that lives
+ * for the whole run (usually a literal).
+ */
+
+struct stats_timer {
+	struct timespec start;
+};
+
+void stats_register(void);
+int stats_enabled(void);
+
+void stats_timer_start(struct stats_timer *t);
+/* Adds the time elapsed since stats_timer_start to the counter 'name'. */
+void stats_timer_stop(struct stats_timer *t, const char *name);
+void stats_count(const char *name, unsigned long n);
+
+void stats_print(void);
+void stats_cleanup(void);
+
+#endif
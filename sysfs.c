@@ -16,112 +16,246 @@
 #include "sysfs.h"
 #include <errno.h>
 #include <fcntl.h>
+#include <net/if.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <syscall.h>
 #include <sys/mount.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "stats.h"
+
+#include "compat.h"
+
 #define PATH "/tmp/plotnetcfg-sys-XXXXXX"
 #define LEN sizeof(PATH)
 
-static char sysfs_mountpoint[LEN];
-long page_size;
+/* Every scanning thread has its own mount, as the mounted sysfs reflects
+ * the net name space of the mounting thread.
+ *
+ * If the kernel supports the new mount API, sysfs is mounted detached: the
+ * mount is not attached anywhere in the file system and is accessible only
+ * through sysfs_fd. It disappears when the fd is closed. Otherwise, it is
+ * mounted to a temporary directory and sysfs_fd refers to that directory.
+ *
+ * The handlers usually look at a few files of the same interface, the
+ * directory of the last interface is kept open in sysfs_if_fd.
+ *
+ * Most name spaces do not need sysfs at all. sysfs_mount only records the
+ * request, the actual mount is done by the first sysfs_root call. */
+static __thread char sysfs_mountpoint[LEN];
+static __thread int sysfs_fd = -1;
+static __thread int sysfs_if_fd = -1;
+static __thread char sysfs_if_name[IFNAMSIZ];
+static __thread const char *sysfs_name;
+static __thread int sysfs_pending;
+static __thread int sysfs_mounted;
+static int sysfs_detached;
+static pthread_once_t sysfs_once = PTHREAD_ONCE_INIT;
 
 void sysfs_clean()
 {
 	struct stat st;
 
-	if (stat(sysfs_mountpoint, &st))
+	if (sysfs_detached) {
+		sysfs_umount();
+		return;
+	}
+
+	if (!*sysfs_mountpoint || stat(sysfs_mountpoint, &st))
 		return;
 
 	if (S_ISDIR(st.st_mode))
 		sysfs_umount();
 
 	rmdir(sysfs_mountpoint);
+	*sysfs_mountpoint = '\0';
+}
+
+/* Returns a detached mount fd or -errno. */
+static int sysfs_fsmount(void)
+{
+	int fsfd, fd;
+
+	fsfd = syscall(__NR_fsopen, "sysfs", FSOPEN_CLOEXEC);
+	if (fsfd < 0)
+		return -errno;
+	if (syscall(__NR_fsconfig, fsfd, FSCONFIG_CMD_CREATE, NULL, NULL, 0) < 0) {
+		fd = -errno;
+		goto out;
+	}
+	fd = syscall(__NR_fsmount, fsfd, FSMOUNT_CLOEXEC, 0);
+	if (fd < 0)
+		fd = -errno;
+out:
+	close(fsfd);
+	return fd;
+}
+
+static void sysfs_init_once(void)
+{
+	int fd;
+
+	fd = sysfs_fsmount();
+	if (fd >= 0) {
+		close(fd);
+		sysfs_detached = 1;
+		return;
+	}
+	atexit(sysfs_clean);
 }
 
 int sysfs_init()
 {
+	pthread_once(&sysfs_once, sysfs_init_once);
+	if (sysfs_detached)
+		return 0;
+
 	strcpy(sysfs_mountpoint, PATH);
 	if (!mkdtemp(sysfs_mountpoint))
 		return errno;
 
-	page_size = sysconf(_SC_PAGESIZE);
+	return 0;
+}
 
-	atexit(sysfs_clean);
+/* Drops the cached interface directory. */
+static void sysfs_if_close(void)
+{
+	if (sysfs_if_fd >= 0)
+		close(sysfs_if_fd);
+	sysfs_if_fd = -1;
+	*sysfs_if_name = '\0';
+}
+
+static int sysfs_do_mount(void)
+{
+	sysfs_pending = 0;
+	stats_count("sysfs mounts", 1);
+	if (sysfs_detached) {
+		sysfs_fd = sysfs_fsmount();
+		if (sysfs_fd < 0)
+			return -sysfs_fd;
+		return 0;
+	}
+	if (mount(sysfs_name, sysfs_mountpoint, "sysfs", 0, NULL) < 0)
+		return errno;
+	sysfs_mounted = 1;
+	/* all lookups go relative to the root of the mount */
+	sysfs_fd = open(sysfs_mountpoint, O_PATH | O_DIRECTORY | O_CLOEXEC);
+	if (sysfs_fd < 0)
+		return errno;
 	return 0;
 }
 
 int sysfs_mount(const char *name)
 {
 	sysfs_umount();
-	if (mount(name, sysfs_mountpoint, "sysfs", 0, NULL) < 0)
-		return errno;
+	sysfs_name = name;
+	sysfs_pending = 1;
 	return 0;
 }
 
 void sysfs_umount()
 {
-	umount2(sysfs_mountpoint, MNT_DETACH);
+	sysfs_if_close();
+	sysfs_pending = 0;
+	if (sysfs_fd >= 0)
+		close(sysfs_fd);
+	sysfs_fd = -1;
+	if (sysfs_mounted)
+		umount2(sysfs_mountpoint, MNT_DETACH);
+	sysfs_mounted = 0;
 }
 
-char *sysfs_realpath(const char *sys_path)
+int sysfs_root(void)
 {
-	char *resolved;
-	char *path;
+	int err;
 
-	if (asprintf(&path, "%s/%s", sysfs_mountpoint, sys_path) < 0)
-		return NULL;
+	if (sysfs_fd >= 0)
+		return sysfs_fd;
+	if (!sysfs_pending)
+		return -EBADF;
+	if ((err = sysfs_do_mount())) {
+		sysfs_umount();
+		return -err;
+	}
+	return sysfs_fd;
+}
 
-	resolved = realpath(path, NULL);
+int sysfs_if_dir(const char *ifname)
+{
+	char path[sizeof("class/net/") + IFNAMSIZ];
+	int root;
 
-	free(path);
+	if (sysfs_if_fd >= 0 && !strcmp(sysfs_if_name, ifname))
+		return sysfs_if_fd;
+	sysfs_if_close();
+	if ((root = sysfs_root()) < 0)
+		return root;
+	if (strlen(ifname) >= IFNAMSIZ)
+		return -ENAMETOOLONG;
 
-	return resolved ? resolved + LEN : NULL;
+	snprintf(path, sizeof(path), "class/net/%s", ifname);
+	sysfs_if_fd = openat(root, path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+	if (sysfs_if_fd < 0)
+		return -errno;
+	strcpy(sysfs_if_name, ifname);
+	return sysfs_if_fd;
 }
 
-ssize_t sysfs_readfile(char **dest, const char *sys_path)
+ssize_t sysfs_read_at(int dirfd, const char *path, char *buf, size_t size)
 {
 	ssize_t ret;
-	char *path;
 	int fd;
 
-	*dest = NULL;
-
-	if (asprintf(&path, "%s/%s", sysfs_mountpoint, sys_path) < 0)
-		return -errno;
-
-	fd = open(path, O_RDONLY);
-	ret = -errno;
-	free(path);
+	if (!size)
+		return -EINVAL;
+	fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
 	if (fd < 0)
-		return ret;
-
-	*dest = malloc(page_size);
-	if (!*dest) {
-		ret = -ENOMEM;
-		goto err;
-	}
-
-	ret = read(fd, *dest, page_size);
-	if (ret <= 0) {
+		return -errno;
+	ret = read(fd, buf, size - 1);
+	if (ret < 0)
 		ret = -errno;
-		free(*dest);
-		*dest = NULL;
-		goto err;
-	}
+	close(fd);
+	if (ret < 0)
+		return ret;
 
 	/* Strip the last newline, as we usually read one line only */
-	(*dest)[ret - 1] = '\0';
-
-err:
-	close(fd);
+	if (ret > 0 && buf[ret - 1] == '\n')
+		ret--;
+	buf[ret] = '\0';
 	return ret;
 }
 
-void sysfs_free(char *path)
+ssize_t sysfs_realpath_at(int dirfd, const char *path, char *buf, size_t size)
 {
-	free(path - LEN);
+	char link[32];
+	size_t prefix;
+	ssize_t len;
+	int fd, err;
+
+	/* There is no realpath relative to a directory fd but the kernel
+	 * tells the path of an open file. It is relative to the root of
+	 * a detached mount, or absolute with the temporary mount point. */
+	fd = openat(dirfd, path, O_PATH | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+	len = readlink(link, buf, size);
+	err = errno;
+	close(fd);
+	if (len < 0)
+		return -err;
+	if ((size_t)len >= size)
+		return -ENAMETOOLONG;
+	buf[len] = '\0';
+
+	prefix = sysfs_detached ? 1 : LEN;
+	if ((size_t)len < prefix)
+		return -ENOENT;
+	memmove(buf, buf + prefix, len - prefix + 1);
+	return len - prefix;
 }
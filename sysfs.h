@@ -18,21 +18,44 @@
 
 #include <sys/types.h>
 
+/*
+ * The mount is per thread. sysfs_init must be called by every thread that
+ * mounts sysfs and sysfs_clean before such thread exits. The mount point of
+ * the main thread is cleaned up automatically at exit. With the new mount
+ * API, sysfs is mounted detached and there is no mount point at all.
+ *
+ * sysfs_mount is lazy: sysfs of the current net name space is mounted by
+ * the first sysfs_root or sysfs_if_dir call, which thus has to be made
+ * while the thread is still in the same name space.
+ */
 int sysfs_init();
+void sysfs_clean();
 int sysfs_mount(const char *name);
 void sysfs_umount();
 
-/**
- * Calls readlink on sys_path inside sysfs.
- * The buffer it returns is allocated with malloc by realpath(3)
- * and must be freed by sysfs_free.
+/*
+ * Returns an fd of the sysfs root or -errno. The fd is owned by sysfs.
+ */
+int sysfs_root(void);
+
+/*
+ * Returns an O_PATH fd of class/net/<ifname> in the current mount or
+ * -errno. The fd is kept open until another interface is asked for or
+ * sysfs is unmounted; the caller must not close it.
+ */
+int sysfs_if_dir(const char *ifname);
+
+/*
+ * Reads a file relative to dirfd into buf. The result is always NUL
+ * terminated with the trailing newline stripped. Returns its length or
+ * -errno.
  */
-char *sysfs_realpath(const char *sys_path);
-void sysfs_free(char *ptr);
+ssize_t sysfs_read_at(int dirfd, const char *path, char *buf, size_t size);
 
 /*
- * Reads file into allocated buffer, must be freed after use.
+ * Resolves a path relative to dirfd into buf, the result is relative to
+ * the sysfs root. Returns its length or -errno.
  */
-ssize_t sysfs_readfile(char **dest, const char *sys_path);
+ssize_t sysfs_realpath_at(int dirfd, const char *path, char *buf, size_t size);
 
 #endif
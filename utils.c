@@ -24,7 +24,7 @@
 
 char *ifstr(struct if_entry *entry)
 {
-	static char buf[IFNAMSIZ + NAME_MAX + 2];
+	static __thread char buf[IFNAMSIZ + NAME_MAX + 2];
 
 	if (!entry->ns->name)
 		/* root ns */
@@ -39,7 +39,7 @@ char *ifstr(struct if_entry *entry)
 #define IFID_MAX (INTERNAL_NS_MAX + NETNS_MAX + IFNAMSIZ + 1)
 char *ifid(struct if_entry *entry)
 {
-	static char buf[IFID_MAX + 1];
+	static __thread char buf[IFID_MAX + 1];
 	char *ins, *ns;
 
 	ins = entry->internal_ns ? : "";
@@ -51,7 +51,7 @@ char *ifid(struct if_entry *entry)
 
 char *ifdrv(struct if_entry *entry)
 {
-	static char buf[256];
+	static __thread char buf[256];
 
 	if (!entry->driver)
 		return "";
@@ -64,7 +64,7 @@ char *ifdrv(struct if_entry *entry)
 
 char *nsid(struct netns_entry *entry)
 {
-	static char buf[NETNS_MAX + 1];
+	static __thread char buf[NETNS_MAX + 1];
 
 	if (!entry->name)
 		return "/";
@@ -75,7 +75,7 @@ char *nsid(struct netns_entry *entry)
 
 char *rtid(struct rtable *rt)
 {
-	static char buf [32];
+	static __thread char buf [32];
 
 	snprintf(buf, sizeof(buf), "%u", rt->id);
 	return buf;
@@ -27,7 +27,7 @@ struct rtable;
 #define ARRAY_SIZE(a)	(sizeof(a) / sizeof(*a))
 
 
-/* Returns static buffer. */
+/* Returns static (per thread) buffer. */
 char *ifstr(struct if_entry *entry);
 char *ifid(struct if_entry *entry);
 char *ifdrv(struct if_entry *entry);
@@ -0,0 +1 @@
+#define VERSION "v0.4.1"